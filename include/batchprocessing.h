@@ -0,0 +1,9 @@
+#ifndef BATCHPROCESSING_H
+#define BATCHPROCESSING_H
+
+class BatchProcessing {
+public:
+    static void processTestFolders();
+};
+
+#endif // BATCHPROCESSING_H
@@ -0,0 +1,99 @@
+#ifndef EPTDAC_H
+#define EPTDAC_H
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#  if defined(EPTDAC_CORE_BUILD)
+#    define EPTDAC_API __declspec(dllexport)
+#  else
+#    define EPTDAC_API __declspec(dllimport)
+#  endif
+#else
+#  define EPTDAC_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum eptdac_status {
+    EPTDAC_OK = 0,
+    EPTDAC_ERROR_INVALID_ARGUMENT = 1,
+    EPTDAC_ERROR_UNSUPPORTED_FORMAT = 2,
+    EPTDAC_ERROR_SIZE_MISMATCH = 3,
+    EPTDAC_ERROR_INTERNAL = 4
+} eptdac_status;
+
+typedef enum eptdac_format {
+    EPTDAC_FORMAT_GRAY8 = 0,
+    EPTDAC_FORMAT_BGR8 = 1,
+    EPTDAC_FORMAT_BGRA8 = 2
+} eptdac_format;
+
+typedef enum eptdac_algorithm {
+    EPTDAC_ALGORITHM_EPTDAC = 0,      /* grayscale output */
+    EPTDAC_ALGORITHM_EPTDAC_RGB = 1,  /* BGR output, TV colour preserved */
+    EPTDAC_ALGORITHM_HALF = 2,
+    EPTDAC_ALGORITHM_MAX = 3,
+    EPTDAC_ALGORITHM_BY_MASK = 4,
+    EPTDAC_ALGORITHM_WAVELET = 5
+} eptdac_algorithm;
+
+typedef enum eptdac_mask_mode {
+    EPTDAC_MASK_GLOBAL = 0,
+    EPTDAC_MASK_LOCAL_MEAN_STD = 1,
+    EPTDAC_MASK_LOCAL_OTSU = 2
+} eptdac_mask_mode;
+
+/* Caller-owned pixel buffer. stride is in bytes; the library never takes
+   ownership and never writes to input images. */
+typedef struct eptdac_image {
+    void* data;
+    size_t stride;
+    int width;
+    int height;
+    eptdac_format format;
+} eptdac_image;
+
+typedef struct eptdac_metrics {
+    double en, sf, ag, sd, ein, ssim_ir, ssim_tv;
+} eptdac_metrics;
+
+typedef struct eptdac_allocation_stats {
+    size_t host_allocations, host_reuses, host_bytes;
+    size_t device_allocations, device_reuses, device_bytes;
+} eptdac_allocation_stats;
+
+typedef struct eptdac_context eptdac_context;
+
+/* width/height are the TV frame size every call on this context must use. */
+EPTDAC_API eptdac_status eptdac_context_create(int width, int height, eptdac_context** ctx);
+EPTDAC_API void eptdac_context_destroy(eptdac_context* ctx);
+EPTDAC_API eptdac_status eptdac_set_mask_mode(eptdac_context* ctx, eptdac_mask_mode mode);
+/* Enables automatic IR/TV registration for the EPTDAC algorithms. The
+   estimate is kept between calls and only refined when it stops fitting. */
+EPTDAC_API eptdac_status eptdac_set_auto_registration(eptdac_context* ctx, int enabled);
+
+/* Fuses tv and ir into out, which must be width x height. When out->format is
+   the algorithm's native one (BGR8 for EPTDAC_RGB, GRAY8 otherwise) the result
+   is written straight into out; otherwise it is converted into it. */
+EPTDAC_API eptdac_status eptdac_fuse(eptdac_context* ctx, eptdac_algorithm algorithm,
+                                     const eptdac_image* tv, const eptdac_image* ir,
+                                     const eptdac_image* out);
+EPTDAC_API eptdac_status eptdac_evaluate(eptdac_context* ctx, const eptdac_image* fused,
+                                         const eptdac_image* ir, const eptdac_image* tv,
+                                         eptdac_metrics* metrics);
+
+/* Scratch-buffer counters of the calling thread. Once a resolution has been
+   processed, further calls at that resolution only increase the reuse counts. */
+EPTDAC_API eptdac_status eptdac_get_allocation_stats(eptdac_allocation_stats* stats);
+
+/* Message of the last failed call on ctx, or an empty string. */
+EPTDAC_API const char* eptdac_last_error(const eptdac_context* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EPTDAC_H */
@@ -0,0 +1,160 @@
+#ifndef FRAMEINGEST_H
+#define FRAMEINGEST_H
+
+#include <opencv2/opencv.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+
+inline int64_t steadyNowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct TimestampedFrame {
+    cv::Mat image;
+    int64_t captureNs = 0;  // steady_clock time the frame left the sensor
+    uint64_t sequence = 0;
+};
+
+// Lock-free ring for exactly one producer thread and one consumer thread.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+public:
+    // Producer side. Returns false and leaves item untouched when full.
+    bool push(T&& item)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+            return false;
+        slots[t & (Capacity - 1)] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: i-th queued element, oldest first, or nullptr.
+    T* at(size_t i)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (tail.load(std::memory_order_acquire) - h <= i)
+            return nullptr;
+        return &slots[(h + i) & (Capacity - 1)];
+    }
+
+    // Consumer side.
+    bool pop(T& item)
+    {
+        T* front = at(0);
+        if (!front)
+            return false;
+        item = std::move(*front);
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    void drop()
+    {
+        T* front = at(0);
+        if (!front)
+            return;
+        *front = T();
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity> slots;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+struct SyncParams {
+    int64_t maxSkewNs = 15000000;   // largest IR/TV capture gap that still pairs
+    int64_t maxAgeNs = 100000000;   // frames older than this are never fused
+    double maxRateHz = 60;          // fastest stream; each ring must hold maxAgeNs of it
+};
+
+struct FramePair {
+    TimestampedFrame ir, tv;
+};
+
+struct SyncCounters {
+    uint64_t pairs = 0;
+    uint64_t irOverflow = 0, tvOverflow = 0;  // rejected because the ring was full
+    uint64_t irStale = 0, tvStale = 0;        // discarded by the synchronizer
+};
+
+// Pairs IR and TV frames by nearest capture time. Each push* method must be
+// called from a single producer thread and nextPair from a single consumer.
+//
+// A full ring rejects the newest frame (counted as overflow): the producer
+// cannot evict the oldest without racing the consumer. The rings hold
+// maxAgeNs at maxRateHz, which the constructor checks, so they only fill once
+// the consumer has fallen more than maxAgeNs behind. The next nextPair then
+// drops everything stale and pairs from the next frames to arrive, so a
+// stall costs at most one frame period beyond its own length.
+class FrameSynchronizer {
+public:
+    explicit FrameSynchronizer(const SyncParams& params = SyncParams());
+
+    bool pushIR(TimestampedFrame&& frame);
+    bool pushTV(TimestampedFrame&& frame);
+
+    // Newest pairable frames, discarding everything a newer pair supersedes.
+    bool nextPair(FramePair& pair);
+
+    SyncCounters counters() const;
+
+private:
+    static constexpr size_t RING_CAPACITY = 8;
+    using Ring = SpscRing<TimestampedFrame, RING_CAPACITY>;
+    static constexpr int64_t NO_FRAME = std::numeric_limits<int64_t>::min();
+
+    static bool push(Ring& ring, std::atomic<int64_t>& latest,
+                     std::atomic<uint64_t>& overflow, TimestampedFrame&& frame);
+    static void dropOlderThan(Ring& ring, int64_t horizonNs, std::atomic<uint64_t>& stale);
+    static bool nextIsCloser(Ring& ring, int64_t targetNs, int64_t distanceNs);
+
+    SyncParams params;
+    Ring irRing, tvRing;
+    std::atomic<int64_t> irLatestNs{NO_FRAME}, tvLatestNs{NO_FRAME};
+    std::atomic<uint64_t> pairs{0};
+    std::atomic<uint64_t> irOverflow{0}, tvOverflow{0};
+    std::atomic<uint64_t> irStale{0}, tvStale{0};
+};
+
+// Glass-to-output latency over the most recent samples.
+class LatencyTracker {
+public:
+    struct Summary {
+        uint64_t count = 0;
+        double p50Ms = 0, p99Ms = 0, maxMs = 0;
+    };
+
+    void record(int64_t latencyNs);
+    Summary summary() const;
+
+private:
+    static constexpr size_t WINDOW = 1024;
+
+    mutable std::mutex mutex;
+    std::array<int64_t, WINDOW> samples{};
+    size_t next = 0, filled = 0;
+    uint64_t count = 0;
+    int64_t maxNs = 0;
+};
+
+#endif // FRAMEINGEST_H
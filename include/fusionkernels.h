@@ -0,0 +1,78 @@
+#ifndef FUSIONKERNELS_H
+#define FUSIONKERNELS_H
+
+#include <opencv2/opencv.hpp>
+
+#include <array>
+
+// Sensor geometries that get CPU kernels specialised at compile time.
+#define EPTDAC_REGISTERED_RESOLUTIONS(X) \
+    X(320, 240)                          \
+    X(640, 480)                          \
+    X(640, 512)                          \
+    X(1280, 720)                         \
+    X(1280, 1024)                        \
+    X(1920, 1080)
+
+constexpr double constexprExp(double x)
+{
+    int halvings = 0;
+    while (x < -0.5 || x > 0.5) {
+        x /= 2;
+        ++halvings;
+    }
+    double term = 1, sum = 1;
+    for (int n = 1; n < 20; ++n) {
+        term *= x / n;
+        sum += term;
+    }
+    while (halvings-- > 0)
+        sum *= sum;
+    return sum;
+}
+
+// Same coefficients as cv::getGaussianKernel(KSize, sigma, CV_32F).
+template <int KSize>
+constexpr std::array<float, KSize> makeGaussianKernel(double sigma)
+{
+    static_assert(KSize % 2 == 1, "Gaussian kernel size must be odd");
+    std::array<double, KSize> w{};
+    double sum = 0;
+    for (int i = 0; i < KSize; ++i) {
+        const double x = i - (KSize - 1) * 0.5;
+        w[i] = constexprExp(-0.5 / (sigma * sigma) * x * x);
+        sum += w[i];
+    }
+    std::array<float, KSize> k{};
+    for (int i = 0; i < KSize; ++i)
+        k[i] = static_cast<float>(w[i] / sum);
+    return k;
+}
+
+// Kernel table for one frame size. select() is meant to be called once per
+// frame size (or per context), so the kernels themselves never branch on it.
+struct FusionKernels {
+    // Haar wavelet fusion of two CV_8UC1 frames into a CV_32FC1 result, also
+    // returning its value range for normalisation. Registered sizes take an
+    // aligned loop when every result row starts on a 64-byte boundary and
+    // the generic one otherwise.
+    using WaveletFn = void (*)(const cv::Mat& tv, const cv::Mat& ir, cv::Mat& result,
+                               float& minValue, float& maxValue);
+    // One row of the local IR mask: thresholds are interpolated between the
+    // tile columns tile0/tile1 with weight.
+    using MaskRowFn = void (*)(const uchar* ir, uchar* mask, const float* rowThresholds,
+                               const int* tile0, const int* tile1, const float* weight, int cols);
+
+    cv::Size size;  // empty for the generic kernels
+    WaveletFn wavelet;
+    MaskRowFn maskRow;
+
+    bool specialized() const { return !size.empty(); }
+
+    static const FusionKernels& select(cv::Size size);
+    static const FusionKernels& generic();
+    static void waveletGeneric32F(const cv::Mat& tv, const cv::Mat& ir, cv::Mat& result,
+                                  float& minValue, float& maxValue);
+};
+
+#endif // FUSIONKERNELS_H
@@ -1,21 +1,59 @@
 #ifndef IMAGEFUSION_H
 #define IMAGEFUSION_H
 
+#include "irmask.h"
+
 #include <opencv2/opencv.hpp>
 
+class ImageRegistration;
+struct FusionKernels;
+
+// Wall time of each EPTDAC/EPTDAC_RGB stage in the last call, in ms.
+struct FusionTimings {
+    enum Stage { Align, EdgeWeights, Mask, Blend, StageCount };
+    double ms[StageCount] = {};
+};
+
+struct FusionOptions {
+    MaskParams mask;
+    ImageRegistration* registration = nullptr;  // used when no matching click points are given
+    const FusionKernels* kernels = nullptr;     // picked once per frame size; selected per call when null
+    FusionTimings* timings = nullptr;           // filled by the EPTDAC variants when set
+};
+
+// Every algorithm writes into result, whose buffer is reused when its size
+// and type already match. The cv::Mat-returning overloads allocate a new one.
 class ImageFusion {
 public:
-    static cv::Mat fuseImagesEPTDAC(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U,
-                             const std::vector<cv::Point2f>& irPoints,
-                             const std::vector<cv::Point2f>& tvPoints);
-    static cv::Mat fuseImagesEPTDAC_RGB(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U,
+    static void fuseImagesEPTDAC(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U,
+                                 const std::vector<cv::Point2f>& irPoints,
+                                 const std::vector<cv::Point2f>& tvPoints,
+                                 cv::OutputArray result, const FusionOptions& options = FusionOptions());
+    static void fuseImagesEPTDAC_RGB(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U,
+                                     const std::vector<cv::Point2f>& tvPoints,
+                                     const std::vector<cv::Point2f>& irPoints,
+                                     cv::OutputArray result, const FusionOptions& options = FusionOptions());
+    static void fuseImagesHalf(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U, cv::OutputArray result);
+    static void fuseImagesMax(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U, cv::OutputArray result);
+    static void fuseImagesByMask(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U, cv::OutputArray result);
+    static void fuseImagesWavelet(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U, cv::OutputArray result);
+    static void fuseImagesWavelet(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U,
+                                  const FusionKernels& kernels, cv::OutputArray result);
+
+    static cv::Mat fuseImagesEPTDAC(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U,
+                                    const std::vector<cv::Point2f>& irPoints,
+                                    const std::vector<cv::Point2f>& tvPoints,
+                                    const FusionOptions& options = FusionOptions());
+    static cv::Mat fuseImagesEPTDAC_RGB(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U,
                                         const std::vector<cv::Point2f>& tvPoints,
-                                        const std::vector<cv::Point2f>& irPoints);
-    static cv::Mat fuseImagesHalf(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U);
-    static cv::Mat fuseImagesMax(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U);
-    static cv::Mat fuseImagesByMask(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U);
-    static cv::Mat fuseImagesWavelet(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U);
-    static void processTestFolders();
+                                        const std::vector<cv::Point2f>& irPoints,
+                                        const FusionOptions& options = FusionOptions());
+    static cv::Mat fuseImagesHalf(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U);
+    static cv::Mat fuseImagesMax(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U);
+    static cv::Mat fuseImagesByMask(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U);
+    static cv::Mat fuseImagesWavelet(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U);
+    static cv::Mat fuseImagesWavelet(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U,
+                                     const FusionKernels& kernels);
 };
 
 #endif // IMAGEFUSION_H
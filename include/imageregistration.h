@@ -0,0 +1,51 @@
+#ifndef IMAGEREGISTRATION_H
+#define IMAGEREGISTRATION_H
+
+#include <opencv2/opencv.hpp>
+
+struct RegistrationParams {
+    int pyramidLevels = 4;        // including full resolution
+    int finestLevel = 1;          // finest level ECC runs on, 0 is full resolution
+    int maxIterations = 50;
+    double epsilon = 1e-4;
+    double refineDrop = 0.05;     // refine once the coarse correlation falls this far
+    double minCorrelation = 0.3;  // refinements scoring below this are rejected
+    int retryInterval = 8;        // frames to wait after a rejected refinement, unless the coarse correlation moves by refineDrop
+};
+
+// Estimates the IR -> TV homography by ECC on gradient-magnitude maps, coarse
+// to fine. Keeps the last estimate as a warm start, so one instance should
+// follow one camera pair.
+class ImageRegistration {
+public:
+    explicit ImageRegistration(const RegistrationParams& params = RegistrationParams());
+
+    // Same convention as cv::findHomography(irPoints, tvPoints).
+    cv::Mat estimate(const cv::Mat& tv, const cv::Mat& ir);
+    void reset();
+
+    double correlation() const { return lastCorrelation; }
+    bool lastRefined() const { return refined; }
+
+private:
+    static cv::Mat toGray(const cv::Mat& img);
+    static void downsample(const cv::Mat& gray, int levels, std::vector<cv::Mat>& pyramid);
+    static cv::Mat edgeMap(const cv::Mat& img);
+    static cv::Matx33f scaleWarp(const cv::Matx33f& warp, double scale);
+    static double correlationAt(const cv::Mat& tvEdges, const cv::Mat& irEdges, const cv::Matx33f& warp);
+    cv::Mat homography() const;
+
+    RegistrationParams params;
+    cv::Matx33f warp = cv::Matx33f::eye();  // TV -> IR at full resolution (ECC convention)
+    bool hasWarp = false;                   // set once a refinement has been accepted
+    double coarseCorrelation = 0;
+    double lastCorrelation = 0;
+    bool refined = false;
+    int retryCountdown = 0;          // frames left before a rejected refinement is retried
+    double rejectedCorrelation = 0;  // coarse correlation the rejected attempt started from
+
+    // Levels 1.. of the gray pyramids, kept so same-size frames reuse them.
+    std::vector<cv::Mat> tvPyr, irPyr;
+};
+
+#endif // IMAGEREGISTRATION_H
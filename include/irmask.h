@@ -0,0 +1,42 @@
+#ifndef IRMASK_H
+#define IRMASK_H
+
+#include <opencv2/opencv.hpp>
+
+struct FusionKernels;
+
+enum class MaskMode {
+    Global,        // single TV-brightness driven threshold (adaptiveThreshold)
+    LocalMeanStd,  // per-tile mean + k * stddev
+    LocalOtsu      // per-tile Otsu threshold
+};
+
+struct MaskParams {
+    MaskMode mode = MaskMode::Global;
+    cv::Size grid = cv::Size(8, 8);
+    double k = 2.0;
+    double minStdDev = 8.0;  // tiles flatter than this are treated as background
+};
+
+struct IRStatistics {
+    double mean = 0, stddev = 0;  // whole frame
+    cv::Size grid;
+    cv::Mat tileMean, tileStdDev, tileOtsu;  // CV_32F, grid.height x grid.width
+    bool hasOtsu = false;                    // tileOtsu is only built on request
+};
+
+// The output-parameter forms reuse the caller's buffers, so a caller that
+// keeps its IRStatistics and mask between same-size frames allocates nothing.
+class IRMask {
+public:
+    static IRStatistics computeStatistics(const cv::Mat& ir, cv::Size grid);
+    // Tile histograms and Otsu thresholds cost far more than the sums, so
+    // they are only built when otsu is set (MaskMode::LocalOtsu).
+    static void computeStatistics(const cv::Mat& ir, cv::Size grid, IRStatistics& stats, bool otsu);
+    static void tileThresholds(const IRStatistics& stats, const MaskParams& params, cv::Mat& thresholds);
+    // kernels must have been selected for ir.size(); other tables fall back to the generic one.
+    static void buildMask(const cv::Mat& ir, const IRStatistics& stats,
+                          const MaskParams& params, const FusionKernels& kernels, cv::Mat& mask);
+};
+
+#endif // IRMASK_H
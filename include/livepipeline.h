@@ -0,0 +1,96 @@
+#ifndef LIVEPIPELINE_H
+#define LIVEPIPELINE_H
+
+#include "frameingest.h"
+#include "imagefusion.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    // Frame captured t seconds after the feed started; empty ends the stream.
+    virtual cv::Mat frameAt(double t) = 0;
+};
+
+// Replays image files in a loop at the feed rate. Files are decoded up front
+// so disk access never shows up as capture jitter.
+class FileReplaySource : public FrameSource {
+public:
+    explicit FileReplaySource(const std::vector<std::string>& files);
+    cv::Mat frameAt(double t) override;
+
+private:
+    std::vector<cv::Mat> frames;
+    size_t next = 0;
+};
+
+// Paces one source at a fixed rate on its own thread, stamping each frame
+// with its scheduled capture time.
+class CameraFeed {
+public:
+    using Sink = std::function<void(TimestampedFrame&&)>;
+
+    CameraFeed(std::unique_ptr<FrameSource> source, double rateHz, Sink sink);
+    ~CameraFeed();
+
+    void start();
+    void stop();
+
+private:
+    void run();
+
+    std::unique_ptr<FrameSource> source;
+    double rateHz;
+    Sink sink;
+    std::atomic<bool> running{false};
+    std::thread thread;
+};
+
+struct PipelineStats {
+    SyncCounters sync;
+    uint64_t fused = 0;
+    LatencyTracker::Summary latency;  // capture of the older frame to output delivered
+};
+
+// Two camera feeds -> FrameSynchronizer -> fusion on a single consumer thread.
+// The consumer always takes the newest pair, so under load frames are dropped
+// rather than queued and latency stays bounded.
+class LivePipeline {
+public:
+    using FuseFn = std::function<cv::Mat(const cv::Mat& tv, const cv::Mat& ir)>;
+    using OutputFn = std::function<void(const cv::Mat& fused, const FramePair& pair)>;
+
+    LivePipeline(std::unique_ptr<FrameSource> irSource, double irRateHz,
+                 std::unique_ptr<FrameSource> tvSource, double tvRateHz,
+                 FuseFn fuse, OutputFn output, const SyncParams& params = SyncParams());
+    ~LivePipeline();
+
+    // EPTDAC_RGB with automatic registration, kernels picked once for frameSize.
+    static FuseFn eptdacFusion(cv::Size frameSize, const MaskParams& mask = MaskParams());
+
+    void start();
+    void stop();
+
+    PipelineStats stats() const;
+
+private:
+    void consume();
+
+    FrameSynchronizer sync;
+    CameraFeed irFeed, tvFeed;
+    FuseFn fuse;
+    OutputFn output;
+    LatencyTracker latency;
+    std::atomic<uint64_t> fused{0};
+    std::atomic<bool> running{false};
+    std::thread consumer;
+};
+
+#endif // LIVEPIPELINE_H
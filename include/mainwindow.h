@@ -2,10 +2,13 @@
 #define MAINWINDOW_H
 
 #include "customimagewidget.h"
+#include "imageregistration.h"
 
 #include <QMainWindow>
 #include <QLabel>
 #include <QPushButton>
+#include <QFutureWatcher>
+#include <QThreadPool>
 
 #include <opencv2/opencv.hpp>
 
@@ -15,7 +18,7 @@ class MainWindow : public QMainWindow
 
 public:
     explicit MainWindow(QWidget *parent = nullptr);
-    ~MainWindow() = default;
+    ~MainWindow();
 
 private slots:
     void loadImageTV();
@@ -23,8 +26,19 @@ private slots:
     void saveImageRes();
     void clearAllPoints();
     void runFusion();
+    void refinementFinished();
 
 private:
+    struct RefinementResult {
+        cv::Mat image;
+        QString error;
+        quint64 generation = 0;
+    };
+
+    cv::Mat fusePreview(const std::vector<cv::Point2f>& tvPoints, const std::vector<cv::Point2f>& irPoints);
+    void startRefinement();
+    void invalidateResult();
+
     void showMatOnWidget(const cv::Mat& mat, CustomImageWidget* widget);
     void showMatOnLabel(const cv::Mat& mat, QLabel* label);
     QImage matToQImage(const cv::Mat& mat);
@@ -46,5 +60,18 @@ private:
     cv::Mat imgTV;
     cv::Mat imgIR;
     cv::Mat imgRes;
+
+    // Full-resolution fusion runs in the background; the label first shows a
+    // preview fused at display size. Only one refinement is ever in flight,
+    // on a single dedicated thread, so one thread holds a full-size arena.
+    QThreadPool refinePool;
+    QFutureWatcher<RefinementResult> refineWatcher;
+    std::vector<cv::Point2f> refineTVPoints, refineIRPoints;
+    quint64 fusionGeneration = 0;
+    bool refinePending = false;
+    bool registrationStale = false;
+
+    ImageRegistration registration;         // used only by the refinement
+    ImageRegistration previewRegistration;  // display-size warp, kept apart from the full-size one
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,92 @@
+#ifndef REGRESSIONRUNNER_H
+#define REGRESSIONRUNNER_H
+
+#include "qualitymetrics.h"
+#include "imagefusion.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <string>
+#include <vector>
+
+struct RegressionCase {
+    std::string name;
+    cv::Mat tv, ir;  // CV_8UC1, same size
+};
+
+struct RegressionTolerances {
+    double absQuality = 1e-3;   // a metric drifts when |current - baseline| exceeds
+    double relQuality = 0.01;   // absQuality + relQuality * |baseline|
+    double timing = 0.15;       // allowed slowdown of a median stage time
+    double timingFloorMs = 0.1; // slowdowns smaller than this are timer noise
+    double ssimExact = 1e-3;    // SSIMEngine exact mode against SSIMReference
+    double ssimFast = 0.05;     // SSIMEngine fast mode against exact mode
+    double registrationPx = 2.0;   // corner error of a recovered homography
+    double registrationWarm = 0.5; // warm-start align time as a fraction of the cold one
+};
+
+struct ImageResult {
+    std::string image;
+    Metrics metrics;
+    double fuseMs = 0;     // best of the repeats
+    double metricsMs = 0;
+    double stageMs[FusionTimings::StageCount] = {};  // of the best repeat, EPTDAC variants only
+};
+
+struct AlgorithmResult {
+    std::string name;
+    std::vector<ImageResult> images;
+    double fuseMs = 0;     // median over images
+    double metricsMs = 0;
+    double stageMs[FusionTimings::StageCount] = {};
+    // One fuse + eval at an already-seen size: new arena blocks (must be 0)
+    // and Mats/GpuMats taken from the default allocators, which must stay
+    // within what OpenCV allocates internally (heapAllowance, not stored).
+    size_t arenaGrowth = 0;
+    size_t heapAllocations = 0;
+    size_t heapAllowance = 0;
+};
+
+struct RegressionReport {
+    std::string dataset;   // identifies the dataset the numbers belong to
+    std::vector<AlgorithmResult> algorithms;
+};
+
+// Runs every fusion algorithm over a dataset, evaluates the results and
+// gates them against a baseline stored with cv::FileStorage. While run() is
+// active the default Mat and GpuMat allocators are wrapped in counters.
+class RegressionRunner {
+public:
+    static std::vector<RegressionCase> syntheticDataset(int count, cv::Size size, unsigned seed);
+    // Every <name>_TV.* under dir (recursively) paired with <name>_IR.*.
+    static std::vector<RegressionCase> folderDataset(const std::string& dir);
+
+    static RegressionReport run(const std::vector<RegressionCase>& dataset,
+                                const std::string& datasetId, int repeats);
+
+    static void save(const RegressionReport& report, const std::string& path);
+    static bool load(const std::string& path, RegressionReport& report);
+
+    // Checks SSIMEngine on every TV/IR pair: exact mssim, map and tiles
+    // against SSIMReference, fast mssim against exact. Needs no baseline.
+    static std::vector<std::string> checkSSIM(const std::vector<RegressionCase>& dataset,
+                                              const RegressionTolerances& tolerances);
+
+    // Feeds FrameSynchronizer known 30 Hz IR and 25 Hz TV timestamps, with
+    // the consumer keeping up and with it stalled, and checks the chosen
+    // pairs and the stale and overflow counters.
+    static std::vector<std::string> checkSync();
+
+    // Warps every IR image by a known homography and fuses it through an
+    // ImageRegistration: the estimate must undo the warp, and a second frame
+    // must take the warm start's cheaper align stage. Needs registered pairs.
+    static std::vector<std::string> checkRegistration(const std::vector<RegressionCase>& dataset,
+                                                      const RegressionTolerances& tolerances);
+
+    // One line per violation; empty when current is within tolerance.
+    static std::vector<std::string> compare(const RegressionReport& baseline,
+                                            const RegressionReport& current,
+                                            const RegressionTolerances& tolerances);
+};
+
+#endif // REGRESSIONRUNNER_H
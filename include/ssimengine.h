@@ -0,0 +1,33 @@
+#ifndef SSIMENGINE_H
+#define SSIMENGINE_H
+
+#include <opencv2/opencv.hpp>
+
+enum class SSIMMode {
+    Exact,  // 11x11 Gaussian window (sigma 1.5), fused per tile
+    Fast    // box window from per-tile integral images of x, y, x^2, y^2, xy
+};
+
+struct SSIMParams {
+    SSIMMode mode = SSIMMode::Exact;
+    int tileSize = 64;  // must be a multiple of mapStep
+    int mapStep = 8;
+    int boxSize = 7;    // window size for SSIMMode::Fast
+};
+
+struct SSIMResult {
+    double mssim = 0;
+    cv::Mat map;    // CV_32F, mean SSIM of every mapStep x mapStep block
+    cv::Mat tiles;  // CV_64F, mean SSIM of every tileSize x tileSize tile
+};
+
+class SSIMEngine {
+public:
+    static SSIMResult compute(const cv::Mat& img1, const cv::Mat& img2,
+                              const SSIMParams& params = SSIMParams());
+    // Reuses the buffers of result, so repeated same-size calls allocate nothing.
+    static void compute(const cv::Mat& img1, const cv::Mat& img2, SSIMResult& result,
+                        const SSIMParams& params = SSIMParams());
+};
+
+#endif // SSIMENGINE_H
@@ -0,0 +1,15 @@
+#ifndef SSIMREFERENCE_H
+#define SSIMREFERENCE_H
+
+#include <opencv2/opencv.hpp>
+
+// The whole-image SSIM that QualityMetrics used before SSIMEngine: five
+// GaussianBlur passes (11x11, sigma 1.5) over float copies. Slow and
+// allocation-heavy, kept only to check SSIMEngine against.
+class SSIMReference {
+public:
+    // Mean SSIM; ssimMap receives the per-pixel CV_32F map.
+    static double compute(const cv::Mat& img1, const cv::Mat& img2, cv::Mat& ssimMap);
+};
+
+#endif // SSIMREFERENCE_H
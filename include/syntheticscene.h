@@ -0,0 +1,32 @@
+#ifndef SYNTHETICSCENE_H
+#define SYNTHETICSCENE_H
+
+#include "livepipeline.h"
+
+#include <opencv2/opencv.hpp>
+
+// Deterministic IR/TV test scene: a textured background with a moving target
+// that is dark in TV and hot in IR. Both modalities agree on the target
+// position at any time t, so streams rendered at different rates still pair.
+class SyntheticScene {
+public:
+    static cv::Mat renderTV(cv::Size size, double t, unsigned seed = 0);
+    static cv::Mat renderIR(cv::Size size, double t, unsigned seed = 0);
+
+private:
+    static cv::Point2f targetAt(cv::Size size, double t, unsigned seed);
+    static void addNoise(cv::Mat& img, double sigma, double t, unsigned seed);
+};
+
+class SyntheticSource : public FrameSource {
+public:
+    SyntheticSource(cv::Size size, bool infrared, unsigned seed = 0);
+    cv::Mat frameAt(double t) override;
+
+private:
+    cv::Size size;
+    bool infrared;
+    unsigned seed;
+};
+
+#endif // SYNTHETICSCENE_H
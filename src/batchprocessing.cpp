@@ -0,0 +1,78 @@
+#include "batchprocessing.h"
+#include "imagefusion.h"
+#include "qualitymetrics.h"
+#include "framearena.h"
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QDebug>
+
+void BatchProcessing::processTestFolders() {
+    QString path = "P:/tests";
+    const QStringList algNames = {"EPTDAC", "Half", "Max", "ByMask", "Wavelet"};
+    int algCount = algNames.size();
+
+    struct Acc { Metrics sum; int cnt = 0; };
+    QMap<QString, Acc> accum;
+    for (const QString& name : algNames) accum[name] = Acc();
+
+    for (int i = 1; i <= 9; ++i) {
+        if (i == 5) continue;
+        QString folder = path + "/" + QString::number(i);
+        QString tvFolder = folder + "/" + QString::number(i) + "_TV.bmp";
+        QString irFolder = folder + "/" + QString::number(i) + "_IR.bmp";
+        cv::Mat tv = cv::imread(tvFolder.toStdString(), cv::IMREAD_GRAYSCALE);
+        cv::Mat ir = cv::imread(irFolder.toStdString(), cv::IMREAD_GRAYSCALE);
+
+        QVector<cv::Mat> fused = {
+            ImageFusion::fuseImagesEPTDAC(tv, ir, {}, {}),
+            ImageFusion::fuseImagesHalf(tv, ir),
+            ImageFusion::fuseImagesMax(tv, ir),
+            ImageFusion::fuseImagesByMask(tv, ir),
+            ImageFusion::fuseImagesWavelet(tv, ir)
+        };
+
+        for (int k = 0; k < algCount; ++k) {
+            const QString& name = algNames[k];
+            Metrics m = QualityMetrics::eval(fused[k], ir, tv);
+            auto &acc = accum[name];
+            acc.cnt++;
+            acc.sum.EN        += m.EN;
+            acc.sum.SF        += m.SF;
+            acc.sum.AG        += m.AG;
+            acc.sum.SD        += m.SD;
+            acc.sum.EIN       += m.EIN;
+            acc.sum.SSIM_IR   += m.SSIM_IR;
+            acc.sum.SSIM_TV   += m.SSIM_TV;
+        }
+    }
+
+    for (const QString& name : algNames) {
+        const auto& acc = accum[name];
+        if (acc.cnt == 0) continue;
+        double n = acc.cnt;
+        double avgSSIM = (acc.sum.SSIM_IR + acc.sum.SSIM_TV) / (2 * n);
+        Metrics avg = {
+            acc.sum.EN / n,
+            acc.sum.SF / n,
+            acc.sum.AG / n,
+            acc.sum.SD / n,
+            acc.sum.EIN / n
+        };
+        qDebug() << name << ":"
+                 << "EN="        << avg.EN
+                 << "SF="        << avg.SF
+                 << "AG="        << avg.AG
+                 << "SD="        << avg.SD
+                 << "EIN="       << avg.EIN
+                 << "Avg SSIM="  << avgSSIM;
+    }
+
+    FrameArena::Stats arena = FrameArena::local().stats();
+    qDebug() << "Frame arena:"
+             << "host allocations="   << arena.hostAllocations
+             << "host reuses="        << arena.hostReuses
+             << "device allocations=" << arena.deviceAllocations
+             << "device reuses="      << arena.deviceReuses;
+}
@@ -0,0 +1,244 @@
+#include "eptdac.h"
+#include "imagefusion.h"
+#include "imageregistration.h"
+#include "framearena.h"
+#include "fusionkernels.h"
+#include "qualitymetrics.h"
+
+#include <exception>
+#include <string>
+
+struct eptdac_context {
+    cv::Size frameSize;
+    const FusionKernels* kernels = nullptr;
+    FusionOptions options;
+    ImageRegistration registration;
+    std::string lastError;
+};
+
+namespace {
+
+int matType(eptdac_format format)
+{
+    switch (format) {
+    case EPTDAC_FORMAT_GRAY8: return CV_8UC1;
+    case EPTDAC_FORMAT_BGR8:  return CV_8UC3;
+    case EPTDAC_FORMAT_BGRA8: return CV_8UC4;
+    }
+    return -1;
+}
+
+eptdac_status fail(eptdac_context* ctx, eptdac_status status, const char* message)
+{
+    // Called from catch handlers, so running out of memory here must not throw again.
+    try {
+        ctx->lastError = message;
+    } catch (...) {
+        ctx->lastError.clear();
+    }
+    return status;
+}
+
+// Wraps a caller buffer in a cv::Mat header without copying.
+eptdac_status wrap(eptdac_context* ctx, const eptdac_image* img, cv::Mat& mat)
+{
+    if (!img || !img->data || img->width <= 0 || img->height <= 0)
+        return fail(ctx, EPTDAC_ERROR_INVALID_ARGUMENT, "image is null or empty");
+
+    const int type = matType(img->format);
+    if (type < 0)
+        return fail(ctx, EPTDAC_ERROR_UNSUPPORTED_FORMAT, "unsupported pixel format");
+    if (img->stride < static_cast<size_t>(img->width) * CV_ELEM_SIZE(type))
+        return fail(ctx, EPTDAC_ERROR_INVALID_ARGUMENT, "stride is smaller than a row");
+
+    mat = cv::Mat(img->height, img->width, type, img->data, img->stride);
+    return EPTDAC_OK;
+}
+
+// The converted copies come from the arena and live only for the call.
+cv::Mat asGray(const cv::Mat& mat)
+{
+    if (mat.channels() == 1)
+        return mat;
+    cv::Mat gray = FrameArena::local().mat();
+    cv::cvtColor(mat, gray, mat.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    return gray;
+}
+
+cv::Mat dropAlpha(const cv::Mat& mat)
+{
+    if (mat.channels() != 4)
+        return mat;
+    cv::Mat bgr = FrameArena::local().mat();
+    cv::cvtColor(mat, bgr, cv::COLOR_BGRA2BGR);
+    return bgr;
+}
+
+// Converts a result in the algorithm's native type into out, which wraps
+// caller memory of the right size and type, so cvtColor writes straight into it.
+void convertResult(const cv::Mat& result, cv::Mat& out)
+{
+    int code;
+    if (result.channels() == 1)
+        code = out.channels() == 3 ? cv::COLOR_GRAY2BGR : cv::COLOR_GRAY2BGRA;
+    else
+        code = out.channels() == 1 ? cv::COLOR_BGR2GRAY : cv::COLOR_BGR2BGRA;
+    cv::cvtColor(result, out, code);
+}
+
+} // namespace
+
+eptdac_status eptdac_context_create(int width, int height, eptdac_context** ctx)
+{
+    if (!ctx || width <= 0 || height <= 0)
+        return EPTDAC_ERROR_INVALID_ARGUMENT;
+
+    try {
+        *ctx = new eptdac_context;
+    } catch (...) {
+        *ctx = nullptr;
+        return EPTDAC_ERROR_INTERNAL;
+    }
+    (*ctx)->frameSize = cv::Size(width, height);
+    (*ctx)->kernels = &FusionKernels::select((*ctx)->frameSize);
+    (*ctx)->options.kernels = (*ctx)->kernels;
+    return EPTDAC_OK;
+}
+
+void eptdac_context_destroy(eptdac_context* ctx)
+{
+    delete ctx;
+}
+
+eptdac_status eptdac_set_mask_mode(eptdac_context* ctx, eptdac_mask_mode mode)
+{
+    if (!ctx)
+        return EPTDAC_ERROR_INVALID_ARGUMENT;
+
+    switch (mode) {
+    case EPTDAC_MASK_GLOBAL:         ctx->options.mask.mode = MaskMode::Global; break;
+    case EPTDAC_MASK_LOCAL_MEAN_STD: ctx->options.mask.mode = MaskMode::LocalMeanStd; break;
+    case EPTDAC_MASK_LOCAL_OTSU:     ctx->options.mask.mode = MaskMode::LocalOtsu; break;
+    default:
+        return fail(ctx, EPTDAC_ERROR_INVALID_ARGUMENT, "unknown mask mode");
+    }
+    return EPTDAC_OK;
+}
+
+eptdac_status eptdac_set_auto_registration(eptdac_context* ctx, int enabled)
+{
+    if (!ctx)
+        return EPTDAC_ERROR_INVALID_ARGUMENT;
+
+    ctx->registration.reset();
+    ctx->options.registration = enabled ? &ctx->registration : nullptr;
+    return EPTDAC_OK;
+}
+
+eptdac_status eptdac_fuse(eptdac_context* ctx, eptdac_algorithm algorithm,
+                          const eptdac_image* tv, const eptdac_image* ir,
+                          const eptdac_image* out)
+{
+    if (!ctx)
+        return EPTDAC_ERROR_INVALID_ARGUMENT;
+    ctx->lastError.clear();
+
+    cv::Mat tvMat, irMat, outMat;
+    eptdac_status status;
+    if ((status = wrap(ctx, tv, tvMat)) != EPTDAC_OK ||
+        (status = wrap(ctx, ir, irMat)) != EPTDAC_OK ||
+        (status = wrap(ctx, out, outMat)) != EPTDAC_OK)
+        return status;
+
+    if (tvMat.size() != ctx->frameSize || outMat.size() != ctx->frameSize)
+        return fail(ctx, EPTDAC_ERROR_SIZE_MISMATCH, "TV or output size differs from the context size");
+    const bool eptdac = algorithm == EPTDAC_ALGORITHM_EPTDAC || algorithm == EPTDAC_ALGORITHM_EPTDAC_RGB;
+    if (!eptdac && irMat.size() != tvMat.size())
+        return fail(ctx, EPTDAC_ERROR_SIZE_MISMATCH, "IR size differs from TV size");
+
+    try {
+        // Fuse straight into the caller's buffer when it has the native type.
+        const bool rgb = algorithm == EPTDAC_ALGORITHM_EPTDAC_RGB;
+        const bool direct = outMat.type() == (rgb ? CV_8UC3 : CV_8UC1);
+        cv::Mat result = direct ? outMat : FrameArena::local().mat();
+        if (rgb) {
+            cv::Mat tvIn = dropAlpha(tvMat), irIn = dropAlpha(irMat);
+            ImageFusion::fuseImagesEPTDAC_RGB(tvIn, irIn, {}, {}, result, ctx->options);
+        } else {
+            cv::Mat tvIn = asGray(tvMat), irIn = asGray(irMat);
+            switch (algorithm) {
+            case EPTDAC_ALGORITHM_EPTDAC:  ImageFusion::fuseImagesEPTDAC(tvIn, irIn, {}, {}, result, ctx->options); break;
+            case EPTDAC_ALGORITHM_HALF:    ImageFusion::fuseImagesHalf(tvIn, irIn, result); break;
+            case EPTDAC_ALGORITHM_MAX:     ImageFusion::fuseImagesMax(tvIn, irIn, result); break;
+            case EPTDAC_ALGORITHM_BY_MASK: ImageFusion::fuseImagesByMask(tvIn, irIn, result); break;
+            case EPTDAC_ALGORITHM_WAVELET: ImageFusion::fuseImagesWavelet(tvIn, irIn, *ctx->kernels, result); break;
+            default:
+                return fail(ctx, EPTDAC_ERROR_INVALID_ARGUMENT, "unknown algorithm");
+            }
+        }
+        if (!direct)
+            convertResult(result, outMat);
+    } catch (const std::exception& e) {
+        return fail(ctx, EPTDAC_ERROR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(ctx, EPTDAC_ERROR_INTERNAL, "unknown error");
+    }
+    return EPTDAC_OK;
+}
+
+eptdac_status eptdac_evaluate(eptdac_context* ctx, const eptdac_image* fused,
+                              const eptdac_image* ir, const eptdac_image* tv,
+                              eptdac_metrics* metrics)
+{
+    if (!ctx)
+        return EPTDAC_ERROR_INVALID_ARGUMENT;
+    ctx->lastError.clear();
+    if (!metrics)
+        return fail(ctx, EPTDAC_ERROR_INVALID_ARGUMENT, "metrics is null");
+
+    cv::Mat fusedMat, irMat, tvMat;
+    eptdac_status status;
+    if ((status = wrap(ctx, fused, fusedMat)) != EPTDAC_OK ||
+        (status = wrap(ctx, ir, irMat)) != EPTDAC_OK ||
+        (status = wrap(ctx, tv, tvMat)) != EPTDAC_OK)
+        return status;
+
+    if (fusedMat.size() != irMat.size() || fusedMat.size() != tvMat.size())
+        return fail(ctx, EPTDAC_ERROR_SIZE_MISMATCH, "fused, IR and TV sizes differ");
+
+    try {
+        Metrics m = QualityMetrics::eval(asGray(fusedMat), asGray(irMat), asGray(tvMat));
+        metrics->en = m.EN;
+        metrics->sf = m.SF;
+        metrics->ag = m.AG;
+        metrics->sd = m.SD;
+        metrics->ein = m.EIN;
+        metrics->ssim_ir = m.SSIM_IR;
+        metrics->ssim_tv = m.SSIM_TV;
+    } catch (const std::exception& e) {
+        return fail(ctx, EPTDAC_ERROR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(ctx, EPTDAC_ERROR_INTERNAL, "unknown error");
+    }
+    return EPTDAC_OK;
+}
+
+eptdac_status eptdac_get_allocation_stats(eptdac_allocation_stats* stats)
+{
+    if (!stats)
+        return EPTDAC_ERROR_INVALID_ARGUMENT;
+
+    const FrameArena::Stats s = FrameArena::local().stats();
+    stats->host_allocations = s.hostAllocations;
+    stats->host_reuses = s.hostReuses;
+    stats->host_bytes = s.hostBytes;
+    stats->device_allocations = s.deviceAllocations;
+    stats->device_reuses = s.deviceReuses;
+    stats->device_bytes = s.deviceBytes;
+    return EPTDAC_OK;
+}
+
+const char* eptdac_last_error(const eptdac_context* ctx)
+{
+    return ctx ? ctx->lastError.c_str() : "";
+}
@@ -0,0 +1,150 @@
+#include "framearena.h"
+
+#include <new>
+
+FrameArena& FrameArena::local()
+{
+    thread_local FrameArena arena;
+    return arena;
+}
+
+FrameArena::FrameArena()
+    : hostAllocator(*this),
+      deviceAllocator(*this)
+{
+}
+
+FrameArena::~FrameArena()
+{
+    for (auto& blocks : freeHostBlocks)
+        for (uchar* block : blocks.second)
+            cv::fastFree(block);
+    for (cv::UMatData* u : freeHeaders)
+        delete u;
+}
+
+cv::Mat FrameArena::mat()
+{
+    cv::Mat m;
+    m.allocator = &hostAllocator;
+    return m;
+}
+
+FrameArena::Stats FrameArena::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void FrameArena::resetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    counters = Stats();
+}
+
+cv::UMatData* FrameArena::HostAllocator::allocate(int dims, const int* sizes, int type, void* data0,
+                                                  size_t* step, cv::AccessFlag, cv::UMatUsageFlags) const
+{
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; --i) {
+        if (step) {
+            if (data0 && step[i] != CV_AUTOSTEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    std::lock_guard<std::mutex> lock(arena.mutex);
+
+    uchar* data = static_cast<uchar*>(data0);
+    if (!data) {
+        std::vector<uchar*>& blocks = arena.freeHostBlocks[total];
+        if (!blocks.empty()) {
+            data = blocks.back();
+            blocks.pop_back();
+            ++arena.counters.hostReuses;
+        } else {
+            data = static_cast<uchar*>(cv::fastMalloc(total));
+            ++arena.counters.hostAllocations;
+            arena.counters.hostBytes += total;
+        }
+    }
+
+    cv::UMatData* u;
+    if (!arena.freeHeaders.empty()) {
+        u = arena.freeHeaders.back();
+        arena.freeHeaders.pop_back();
+        u->~UMatData();
+        new (u) cv::UMatData(this);
+    } else {
+        u = new cv::UMatData(this);
+    }
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0)
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+    return u;
+}
+
+bool FrameArena::HostAllocator::allocate(cv::UMatData* u, cv::AccessFlag, cv::UMatUsageFlags) const
+{
+    return u != nullptr;
+}
+
+void FrameArena::HostAllocator::deallocate(cv::UMatData* u) const
+{
+    if (!u)
+        return;
+    CV_Assert(u->urefcount == 0 && u->refcount == 0);
+
+    std::lock_guard<std::mutex> lock(arena.mutex);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED))
+        arena.freeHostBlocks[u->size].push_back(u->origdata);
+    u->data = u->origdata = nullptr;
+    arena.freeHeaders.push_back(u);
+}
+
+bool FrameArena::DeviceAllocator::allocate(cv::cuda::GpuMat* mat, int rows, int cols, size_t elemSize)
+{
+    std::lock_guard<std::mutex> lock(arena.mutex);
+
+    DeviceBlock* block = nullptr;
+    for (DeviceBlock& b : arena.deviceBlocks)
+        if (!b.inUse && b.rows == rows && b.cols == cols && b.elemSize == elemSize) {
+            block = &b;
+            break;
+        }
+
+    if (block) {
+        ++arena.counters.deviceReuses;
+    } else {
+        arena.deviceBlocks.emplace_back();
+        block = &arena.deviceBlocks.back();
+        block->backing.create(rows, cols, CV_8UC(static_cast<int>(elemSize)));
+        block->rows = rows;
+        block->cols = cols;
+        block->elemSize = elemSize;
+        ++arena.counters.deviceAllocations;
+        arena.counters.deviceBytes += block->backing.step * rows;
+    }
+
+    block->inUse = true;
+    mat->data = block->backing.data;
+    mat->step = block->backing.step;
+    mat->refcount = &block->refcount;
+    return true;
+}
+
+void FrameArena::DeviceAllocator::free(cv::cuda::GpuMat* mat)
+{
+    std::lock_guard<std::mutex> lock(arena.mutex);
+    for (DeviceBlock& b : arena.deviceBlocks)
+        if (b.backing.data == mat->datastart) {
+            b.inUse = false;
+            return;
+        }
+}
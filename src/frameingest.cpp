@@ -0,0 +1,131 @@
+#include "frameingest.h"
+
+#include <algorithm>
+#include <vector>
+
+FrameSynchronizer::FrameSynchronizer(const SyncParams& params)
+    : params(params)
+{
+    CV_Assert(params.maxAgeNs * params.maxRateHz <= (RING_CAPACITY - 1) * 1e9);
+}
+
+bool FrameSynchronizer::pushIR(TimestampedFrame&& frame)
+{
+    return push(irRing, irLatestNs, irOverflow, std::move(frame));
+}
+
+bool FrameSynchronizer::pushTV(TimestampedFrame&& frame)
+{
+    return push(tvRing, tvLatestNs, tvOverflow, std::move(frame));
+}
+
+bool FrameSynchronizer::push(Ring& ring, std::atomic<int64_t>& latest,
+                             std::atomic<uint64_t>& overflow, TimestampedFrame&& frame)
+{
+    const int64_t captureNs = frame.captureNs;
+    if (!ring.push(std::move(frame))) {
+        overflow.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    latest.store(captureNs, std::memory_order_release);
+    return true;
+}
+
+bool FrameSynchronizer::nextPair(FramePair& pair)
+{
+    // Anything older than the newest time both streams have reached, minus
+    // the skew window, can only form a pair that a newer one supersedes.
+    int64_t horizonNs = steadyNowNs() - params.maxAgeNs;
+    const int64_t irLatest = irLatestNs.load(std::memory_order_acquire);
+    const int64_t tvLatest = tvLatestNs.load(std::memory_order_acquire);
+    if (irLatest != NO_FRAME && tvLatest != NO_FRAME)
+        horizonNs = std::max(horizonNs, std::min(irLatest, tvLatest) - params.maxSkewNs);
+
+    dropOlderThan(irRing, horizonNs, irStale);
+    dropOlderThan(tvRing, horizonNs, tvStale);
+
+    for (;;) {
+        TimestampedFrame* ir = irRing.at(0);
+        TimestampedFrame* tv = tvRing.at(0);
+        if (!ir || !tv)
+            return false;
+
+        const int64_t d = ir->captureNs - tv->captureNs;
+        if (d < -params.maxSkewNs || (d < 0 && nextIsCloser(irRing, tv->captureNs, -d))) {
+            irRing.drop();
+            irStale.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (d > params.maxSkewNs || (d > 0 && nextIsCloser(tvRing, ir->captureNs, d))) {
+            tvRing.drop();
+            tvStale.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        irRing.pop(pair.ir);
+        tvRing.pop(pair.tv);
+        pairs.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+}
+
+void FrameSynchronizer::dropOlderThan(Ring& ring, int64_t horizonNs, std::atomic<uint64_t>& stale)
+{
+    for (TimestampedFrame* f = ring.at(0); f && f->captureNs < horizonNs; f = ring.at(0)) {
+        ring.drop();
+        stale.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool FrameSynchronizer::nextIsCloser(Ring& ring, int64_t targetNs, int64_t distanceNs)
+{
+    const TimestampedFrame* next = ring.at(1);
+    if (!next)
+        return false;
+    const int64_t d = next->captureNs - targetNs;
+    return (d < 0 ? -d : d) <= distanceNs;
+}
+
+SyncCounters FrameSynchronizer::counters() const
+{
+    SyncCounters c;
+    c.pairs = pairs.load(std::memory_order_relaxed);
+    c.irOverflow = irOverflow.load(std::memory_order_relaxed);
+    c.tvOverflow = tvOverflow.load(std::memory_order_relaxed);
+    c.irStale = irStale.load(std::memory_order_relaxed);
+    c.tvStale = tvStale.load(std::memory_order_relaxed);
+    return c;
+}
+
+void LatencyTracker::record(int64_t latencyNs)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    samples[next] = latencyNs;
+    next = (next + 1) % WINDOW;
+    filled = std::min(filled + 1, WINDOW);
+    ++count;
+    maxNs = std::max(maxNs, latencyNs);
+}
+
+LatencyTracker::Summary LatencyTracker::summary() const
+{
+    std::vector<int64_t> window;
+    Summary s;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        window.assign(samples.begin(), samples.begin() + filled);
+        s.count = count;
+        s.maxMs = maxNs / 1e6;
+    }
+    if (window.empty())
+        return s;
+
+    auto percentile = [&window](double p) {
+        const size_t k = std::min(window.size() - 1, static_cast<size_t>(p * window.size()));
+        std::nth_element(window.begin(), window.begin() + k, window.end());
+        return window[k] / 1e6;
+    };
+    s.p50Ms = percentile(0.50);
+    s.p99Ms = percentile(0.99);
+    return s;
+}
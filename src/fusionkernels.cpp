@@ -0,0 +1,117 @@
+#include "fusionkernels.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__GNUC__)
+#define EPTDAC_ASSUME_ALIGNED(p, n) static_cast<decltype(p)>(__builtin_assume_aligned((p), (n)))
+#else
+#define EPTDAC_ASSUME_ALIGNED(p, n) (p)
+#endif
+
+namespace {
+
+// W and H are 0 for the generic instantiation and the frame size otherwise,
+// which turns every loop bound into a constant.
+template <typename T, int W, int H>
+void waveletKernel(const cv::Mat& tv, const cv::Mat& ir, cv::Mat& result,
+                   float& minValue, float& maxValue)
+{
+    if constexpr (W != 0 && W % 16 == 0) {
+        // The loop assumes 64-byte aligned output rows, which an ROI or a
+        // caller-wrapped buffer need not have.
+        if ((reinterpret_cast<uintptr_t>(result.data) | result.step[0]) % 64 != 0) {
+            waveletKernel<T, 0, 0>(tv, ir, result, minValue, maxValue);
+            return;
+        }
+    }
+
+    const int cols = W ? W : tv.cols;
+    const int rows = H ? H : tv.rows;
+    const int evenCols = cols & ~1, evenRows = rows & ~1;
+
+    float lo = FLT_MAX, hi = -FLT_MAX;
+    for (int i = 0; i < evenRows; i += 2) {
+        const T* t0 = tv.ptr<T>(i);
+        const T* t1 = tv.ptr<T>(i + 1);
+        const T* r0 = ir.ptr<T>(i);
+        const T* r1 = ir.ptr<T>(i + 1);
+        float* o0 = result.ptr<float>(i);
+        float* o1 = result.ptr<float>(i + 1);
+        if constexpr (W != 0 && W % 16 == 0) {
+            o0 = EPTDAC_ASSUME_ALIGNED(o0, 64);
+            o1 = EPTDAC_ASSUME_ALIGNED(o1, 64);
+        }
+
+        for (int j = 0; j < evenCols; j += 2) {
+            float a = t0[j], b = t0[j + 1], c = t1[j], d = t1[j + 1];
+            const float lowTV = (a + b + c + d) / 4, highTV = std::fabs(a - b - c + d);
+            a = r0[j]; b = r0[j + 1]; c = r1[j]; d = r1[j + 1];
+            const float lowIR = (a + b + c + d) / 4, highIR = std::fabs(a - b - c + d);
+
+            const float l = std::max(lowTV, lowIR), h = std::max(highTV, highIR);
+            o0[j] = l + h;
+            o0[j + 1] = l - h;
+            o1[j] = l - h;
+            o1[j + 1] = l + h;
+            lo = std::min(lo, l - h);
+            hi = std::max(hi, l + h);
+        }
+        if (evenCols != cols) {
+            o0[cols - 1] = o0[cols - 2];
+            o1[cols - 1] = o1[cols - 2];
+        }
+    }
+    if (evenRows != rows && rows > 1)
+        result.row(rows - 2).copyTo(result.row(rows - 1));
+
+    minValue = lo;
+    maxValue = hi;
+}
+
+template <int W>
+void maskRowKernel(const uchar* ir, uchar* mask, const float* rowThresholds,
+                   const int* tile0, const int* tile1, const float* weight, int cols)
+{
+    const int n = W ? W : cols;
+    for (int x = 0; x < n; ++x) {
+        const float a = rowThresholds[tile0[x]], b = rowThresholds[tile1[x]];
+        mask[x] = ir[x] > a + (b - a) * weight[x] ? 255 : 0;
+    }
+}
+
+const FusionKernels GENERIC_KERNELS = {
+    cv::Size(), &waveletKernel<uchar, 0, 0>, &maskRowKernel<0>
+};
+
+#define EPTDAC_KERNEL_ENTRY(w, h) \
+    {cv::Size(w, h), &waveletKernel<uchar, w, h>, &maskRowKernel<w>},
+
+const FusionKernels REGISTERED_KERNELS[] = {
+    EPTDAC_REGISTERED_RESOLUTIONS(EPTDAC_KERNEL_ENTRY)
+};
+
+#undef EPTDAC_KERNEL_ENTRY
+
+} // namespace
+
+const FusionKernels& FusionKernels::select(cv::Size size)
+{
+    for (const FusionKernels& kernels : REGISTERED_KERNELS)
+        if (kernels.size == size)
+            return kernels;
+    return GENERIC_KERNELS;
+}
+
+const FusionKernels& FusionKernels::generic()
+{
+    return GENERIC_KERNELS;
+}
+
+void FusionKernels::waveletGeneric32F(const cv::Mat& tv, const cv::Mat& ir, cv::Mat& result,
+                                      float& minValue, float& maxValue)
+{
+    waveletKernel<float, 0, 0>(tv, ir, result, minValue, maxValue);
+}
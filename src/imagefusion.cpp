@@ -1,98 +1,165 @@
 #include "imagefusion.h"
-#include "qualitymetrics.h"
-
-#include <QString>
-#include <QList>
-#include <QMap>
-#include <QDebug>
+#include "imageregistration.h"
+#include "framearena.h"
+#include "fusionkernels.h"
 
 #include <opencv2/cudaarithm.hpp>
 #include <opencv2/cudaimgproc.hpp>
 #include <opencv2/cudafilters.hpp>
 
+#include <cfloat>
+
 const double ALPHA = 2;
 const double UP_THRESHOLD = 165;
 const double DOWN_THRESHOLD = 30;
 
-cv::Mat ImageFusion::fuseImagesEPTDAC(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U,
-                                     const std::vector<cv::Point2f>& tvPoints,
-                                     const std::vector<cv::Point2f>& irPoints)
+namespace {
+
+// Charges elapsed time to the current stage; a no-op without a timings sink.
+class StageTimer {
+public:
+    explicit StageTimer(FusionTimings* timings) : timings(timings)
+    {
+        if (timings)
+            *timings = FusionTimings();
+    }
+    ~StageTimer() { stop(); }
+
+    void begin(FusionTimings::Stage next)
+    {
+        stop();
+        stage = next;
+        start = cv::getTickCount();
+    }
+
+private:
+    void stop()
+    {
+        if (timings && stage != FusionTimings::StageCount)
+            timings->ms[stage] += (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+        stage = FusionTimings::StageCount;
+    }
+
+    FusionTimings* timings;
+    FusionTimings::Stage stage = FusionTimings::StageCount;
+    int64 start = 0;
+};
+
+// Returns IR resized and warped onto TV, or IR itself when neither is needed.
+// Intermediates come from the arena, so the result must not outlive the call.
+cv::Mat alignIR(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U,
+                const std::vector<cv::Point2f>& tvPoints,
+                const std::vector<cv::Point2f>& irPoints,
+                const FusionOptions& options)
 {
+    FrameArena& arena = FrameArena::local();
+    cv::Mat IR_resized = IR_CPU_8U;
     if (IR_CPU_8U.size() != TV_CPU_8U.size()) {
-        cv::resize(IR_CPU_8U, IR_CPU_8U, TV_CPU_8U.size(), 0, 0, cv::INTER_LINEAR);
+        IR_resized = arena.mat();
+        cv::resize(IR_CPU_8U, IR_resized, TV_CPU_8U.size(), 0, 0, cv::INTER_LINEAR);
     }
 
-    if (!irPoints.empty() && irPoints.size() == tvPoints.size()) {
-        cv::Mat H = cv::findHomography(irPoints, tvPoints);
-        cv::Mat IR_aligned;
-        cv::warpPerspective(IR_CPU_8U, IR_aligned, H, TV_CPU_8U.size());
-        IR_CPU_8U = IR_aligned;
-    }
+    cv::Mat H;
+    if (!irPoints.empty() && irPoints.size() == tvPoints.size())
+        H = cv::findHomography(irPoints, tvPoints);
+    else if (options.registration)
+        H = options.registration->estimate(TV_CPU_8U, IR_resized);
+
+    if (H.empty())
+        return IR_resized;
+
+    cv::Mat IR_aligned = arena.mat();
+    cv::warpPerspective(IR_resized, IR_aligned, H, TV_CPU_8U.size());
+    return IR_aligned;
+}
 
+cv::Mat toGray(const cv::Mat& img)
+{
+    if (img.channels() != 3)
+        return img;
+    cv::Mat gray = FrameArena::local().mat();
+    cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+    return gray;
+}
+
+} // namespace
+
+void ImageFusion::fuseImagesEPTDAC(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_In,
+                                   const std::vector<cv::Point2f>& tvPoints,
+                                   const std::vector<cv::Point2f>& irPoints,
+                                   cv::OutputArray result, const FusionOptions& options)
+{
+    StageTimer timer(options.timings);
+    timer.begin(FusionTimings::Align);
+    const cv::Mat IR_CPU_8U = alignIR(TV_CPU_8U, IR_In, tvPoints, irPoints, options);
+
+    FrameArena& arena = FrameArena::local();
+    cv::cuda::GpuMat::Allocator* gpu = arena.device();
+
+    timer.begin(FusionTimings::EdgeWeights);
     cv::Scalar M_IR_CPU, D_IR_CPU;
     cv::meanStdDev(IR_CPU_8U, M_IR_CPU, D_IR_CPU);
 
-    cv::cuda::GpuMat IR_GPU_8U, E_IR_GPU_8U, E_IR_GPU_32F;
+    cv::cuda::GpuMat IR_GPU_8U(gpu), E_IR_GPU_8U(gpu), E_IR_GPU_32F(gpu);
     IR_GPU_8U.upload(IR_CPU_8U);
     cv::cuda::subtract(IR_GPU_8U, M_IR_CPU[0], E_IR_GPU_8U);
     cv::cuda::divide(E_IR_GPU_8U, D_IR_CPU[0], E_IR_GPU_8U);
 
-    cv::cuda::GpuMat TV_GPU_8U, TV_GPU_32F;
+    cv::cuda::GpuMat TV_GPU_8U(gpu), TV_GPU_32F(gpu);
     TV_GPU_8U.upload(TV_CPU_8U);
     TV_GPU_8U.convertTo(TV_GPU_32F, CV_32F);
 
-    auto sobelX = cv::cuda::createSobelFilter(CV_32F, CV_32F, 1, 0, 3);
-    auto sobelY = cv::cuda::createSobelFilter(CV_32F, CV_32F, 0, 1, 3);
+    thread_local auto sobelX = cv::cuda::createSobelFilter(CV_32F, CV_32F, 1, 0, 3);
+    thread_local auto sobelY = cv::cuda::createSobelFilter(CV_32F, CV_32F, 0, 1, 3);
 
-    cv::cuda::GpuMat gradX, gradY;
+    cv::cuda::GpuMat gradX(gpu), gradY(gpu);
     sobelX->apply(TV_GPU_32F, gradX);
     sobelY->apply(TV_GPU_32F, gradY);
 
-    cv::cuda::GpuMat gradX2, gradY2, gradSum, E_TV_GPU_32F;
+    cv::cuda::GpuMat gradX2(gpu), gradY2(gpu), gradSum(gpu), E_TV_GPU_32F(gpu);
     cv::cuda::multiply(gradX, gradX, gradX2);
     cv::cuda::multiply(gradY, gradY, gradY2);
     cv::cuda::add(gradX2, gradY2, gradSum);
     cv::cuda::sqrt(gradSum, E_TV_GPU_32F);
 
-    cv::Mat E_TV_CPU_32F;
+    cv::Mat E_TV_CPU_32F = arena.mat();
     E_TV_GPU_32F.download(E_TV_CPU_32F);
     E_IR_GPU_8U.convertTo(E_IR_GPU_32F, CV_32F);
 
     cv::cuda::normalize(E_TV_GPU_32F, E_TV_GPU_32F, 0.0, 1.0, cv::NORM_MINMAX, CV_32F);
     cv::cuda::normalize(E_IR_GPU_32F, E_IR_GPU_32F, 0.0, 1.0, cv::NORM_MINMAX, CV_32F);
 
-    cv::cuda::GpuMat diff_E_GPU;
+    cv::cuda::GpuMat diff_E_GPU(gpu);
     cv::cuda::subtract(E_TV_GPU_32F, E_IR_GPU_32F, diff_E_GPU);
 
-    cv::cuda::GpuMat weight_TV_GPU, weight_IR_GPU, sigmoid_GPU;
+    cv::cuda::GpuMat weight_TV_GPU(gpu), weight_IR_GPU(gpu), sigmoid_GPU(gpu);
     cv::cuda::multiply(diff_E_GPU, ALPHA, sigmoid_GPU);
 
-    cv::cuda::GpuMat exp_GPU, neg_sigmoid_GPU;
+    cv::cuda::GpuMat exp_GPU(gpu), neg_sigmoid_GPU(gpu);
     cv::cuda::subtract(0.0, sigmoid_GPU, neg_sigmoid_GPU);
     cv::cuda::exp(neg_sigmoid_GPU, exp_GPU);
     cv::cuda::add(exp_GPU, 1.0, exp_GPU);
     cv::cuda::divide(1.0, exp_GPU, weight_TV_GPU);
     cv::cuda::subtract(1.0, weight_TV_GPU, weight_IR_GPU);
 
-    cv::cuda::GpuMat weight_TV_blur_GPU, weight_IR_blur_GPU;
-    auto gauss = cv::cuda::createGaussianFilter(CV_32F, CV_32F, cv::Size(9, 9), 3);
+    cv::cuda::GpuMat weight_TV_blur_GPU(gpu), weight_IR_blur_GPU(gpu);
+    thread_local auto gauss = cv::cuda::createGaussianFilter(CV_32F, CV_32F, cv::Size(9, 9), 3);
     gauss->apply(weight_TV_GPU, weight_TV_blur_GPU);
     gauss->apply(weight_IR_GPU, weight_IR_blur_GPU);
 
-    cv::cuda::GpuMat IR_GPU_32F;
+    timer.begin(FusionTimings::Blend);
+    cv::cuda::GpuMat IR_GPU_32F(gpu);
     IR_GPU_8U.convertTo(IR_GPU_32F, CV_32F);
 
-    cv::cuda::GpuMat fused_TV_GPU, fused_IR_GPU, result_GPU;
+    cv::cuda::GpuMat fused_TV_GPU(gpu), fused_IR_GPU(gpu), result_GPU(gpu);
     cv::cuda::multiply(weight_TV_blur_GPU, TV_GPU_32F, fused_TV_GPU);
     cv::cuda::multiply(weight_IR_blur_GPU, IR_GPU_32F, fused_IR_GPU);
     cv::cuda::add(fused_TV_GPU, fused_IR_GPU, result_GPU);
 
-    cv::Mat result_CPU;
-    result_GPU.download(result_CPU);
-    cv::normalize(result_CPU, result_CPU, 0, 255, cv::NORM_MINMAX);
-    result_CPU.convertTo(result_CPU, CV_8U);
-
-    return result_CPU;
+    cv::Mat result_CPU_32F = arena.mat();
+    result_GPU.download(result_CPU_32F);
+    cv::normalize(result_CPU_32F, result_CPU_32F, 0, 255, cv::NORM_MINMAX);
+    result_CPU_32F.convertTo(result, CV_8U);
 }
 
 double adaptiveThreshold(const cv::Mat& tv)
@@ -102,52 +169,47 @@ double adaptiveThreshold(const cv::Mat& tv)
     return (brightness > 100) ? UP_THRESHOLD : DOWN_THRESHOLD;
 }
 
-cv::Mat ImageFusion::fuseImagesEPTDAC_RGB(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U,
-                                      const std::vector<cv::Point2f>& tvPoints,
-                                      const std::vector<cv::Point2f>& irPoints)
+void ImageFusion::fuseImagesEPTDAC_RGB(const cv::Mat& TV_In, const cv::Mat& IR_In,
+                                       const std::vector<cv::Point2f>& tvPoints,
+                                       const std::vector<cv::Point2f>& irPoints,
+                                       cv::OutputArray result, const FusionOptions& options)
 {
-    if (IR_CPU_8U.size() != TV_CPU_8U.size()) {
-        cv::resize(IR_CPU_8U, IR_CPU_8U, TV_CPU_8U.size(), 0, 0, cv::INTER_LINEAR);
+    StageTimer timer(options.timings);
+    timer.begin(FusionTimings::Align);
+    FrameArena& arena = FrameArena::local();
+    cv::cuda::GpuMat::Allocator* gpu = arena.device();
+
+    cv::Mat TV_Color_BGR = TV_In;
+    if (TV_In.channels() != 3) {
+        TV_Color_BGR = arena.mat();
+        cv::cvtColor(TV_In, TV_Color_BGR, cv::COLOR_GRAY2BGR);
     }
 
-    if (!irPoints.empty() && irPoints.size() == tvPoints.size()) {
-        cv::Mat H = cv::findHomography(irPoints, tvPoints);
-        cv::Mat IR_aligned;
-        cv::warpPerspective(IR_CPU_8U, IR_aligned, H, TV_CPU_8U.size());
-        IR_CPU_8U = IR_aligned;
-    }
+    const cv::Mat TV_CPU_8U = toGray(TV_In);
+    const cv::Mat IR_CPU_8U = toGray(alignIR(TV_In, IR_In, tvPoints, irPoints, options));
 
-    cv::Mat TV_Color_BGR;
-    if (TV_CPU_8U.channels() == 3)
-        TV_Color_BGR = TV_CPU_8U.clone();
-    else
-        cv::cvtColor(TV_CPU_8U, TV_Color_BGR, cv::COLOR_GRAY2BGR);
-
-    if (TV_CPU_8U.channels() == 3)
-        cv::cvtColor(TV_CPU_8U, TV_CPU_8U, cv::COLOR_BGR2GRAY);
-    if (IR_CPU_8U.channels() == 3)
-        cv::cvtColor(IR_CPU_8U, IR_CPU_8U, cv::COLOR_BGR2GRAY);
-
-    cv::Scalar M_IR_CPU, D_IR_CPU;
-    cv::meanStdDev(IR_CPU_8U, M_IR_CPU, D_IR_CPU);
+    timer.begin(FusionTimings::EdgeWeights);
+    thread_local IRStatistics irStats;
+    IRMask::computeStatistics(IR_CPU_8U, options.mask.grid, irStats,
+                              options.mask.mode == MaskMode::LocalOtsu);
 
-    cv::cuda::GpuMat IR_GPU_8U, E_IR_GPU_8U, E_IR_GPU_32F;
+    cv::cuda::GpuMat IR_GPU_8U(gpu), E_IR_GPU_8U(gpu), E_IR_GPU_32F(gpu);
     IR_GPU_8U.upload(IR_CPU_8U);
-    cv::cuda::subtract(IR_GPU_8U, M_IR_CPU[0], E_IR_GPU_8U);
-    cv::cuda::divide(E_IR_GPU_8U, D_IR_CPU[0], E_IR_GPU_8U);
+    cv::cuda::subtract(IR_GPU_8U, irStats.mean, E_IR_GPU_8U);
+    cv::cuda::divide(E_IR_GPU_8U, irStats.stddev, E_IR_GPU_8U);
 
-    cv::cuda::GpuMat TV_GPU_8U, TV_GPU_32F;
+    cv::cuda::GpuMat TV_GPU_8U(gpu), TV_GPU_32F(gpu);
     TV_GPU_8U.upload(TV_CPU_8U);
     TV_GPU_8U.convertTo(TV_GPU_32F, CV_32F);
 
-    auto sobelX = cv::cuda::createSobelFilter(CV_32F, CV_32F, 1, 0, 3);
-    auto sobelY = cv::cuda::createSobelFilter(CV_32F, CV_32F, 0, 1, 3);
+    thread_local auto sobelX = cv::cuda::createSobelFilter(CV_32F, CV_32F, 1, 0, 3);
+    thread_local auto sobelY = cv::cuda::createSobelFilter(CV_32F, CV_32F, 0, 1, 3);
 
-    cv::cuda::GpuMat gradX, gradY;
+    cv::cuda::GpuMat gradX(gpu), gradY(gpu);
     sobelX->apply(TV_GPU_32F, gradX);
     sobelY->apply(TV_GPU_32F, gradY);
 
-    cv::cuda::GpuMat gradX2, gradY2, gradSum, E_TV_GPU_32F;
+    cv::cuda::GpuMat gradX2(gpu), gradY2(gpu), gradSum(gpu), E_TV_GPU_32F(gpu);
     cv::cuda::multiply(gradX, gradX, gradX2);
     cv::cuda::multiply(gradY, gradY, gradY2);
     cv::cuda::add(gradX2, gradY2, gradSum);
@@ -158,191 +220,170 @@ cv::Mat ImageFusion::fuseImagesEPTDAC_RGB(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U
     cv::cuda::normalize(E_TV_GPU_32F, E_TV_GPU_32F, 0.0, 1.0, cv::NORM_MINMAX, CV_32F);
     cv::cuda::normalize(E_IR_GPU_32F, E_IR_GPU_32F, 0.0, 1.0, cv::NORM_MINMAX, CV_32F);
 
-    cv::cuda::GpuMat diff_E_GPU;
+    cv::cuda::GpuMat diff_E_GPU(gpu);
     cv::cuda::subtract(E_TV_GPU_32F, E_IR_GPU_32F, diff_E_GPU);
 
-    cv::cuda::GpuMat weight_TV_GPU, weight_IR_GPU, sigmoid_GPU;
+    cv::cuda::GpuMat weight_TV_GPU(gpu), weight_IR_GPU(gpu), sigmoid_GPU(gpu);
     cv::cuda::multiply(diff_E_GPU, ALPHA, sigmoid_GPU);
 
-    cv::cuda::GpuMat exp_GPU, neg_sigmoid_GPU;
+    cv::cuda::GpuMat exp_GPU(gpu), neg_sigmoid_GPU(gpu);
     cv::cuda::subtract(0.0, sigmoid_GPU, neg_sigmoid_GPU);
     cv::cuda::exp(neg_sigmoid_GPU, exp_GPU);
     cv::cuda::add(exp_GPU, 1.0, exp_GPU);
     cv::cuda::divide(1.0, exp_GPU, weight_TV_GPU);
     cv::cuda::subtract(1.0, weight_TV_GPU, weight_IR_GPU);
 
-    cv::cuda::GpuMat weight_TV_blur_GPU, weight_IR_blur_GPU;
-    auto gauss = cv::cuda::createGaussianFilter(CV_32F, CV_32F, cv::Size(9, 9), 3);
+    cv::cuda::GpuMat weight_TV_blur_GPU(gpu), weight_IR_blur_GPU(gpu);
+    thread_local auto gauss = cv::cuda::createGaussianFilter(CV_32F, CV_32F, cv::Size(9, 9), 3);
     gauss->apply(weight_TV_GPU, weight_TV_blur_GPU);
     gauss->apply(weight_IR_GPU, weight_IR_blur_GPU);
 
-    cv::cuda::GpuMat IR_GPU_32F;
+    timer.begin(FusionTimings::Blend);
+    cv::cuda::GpuMat IR_GPU_32F(gpu);
     IR_GPU_8U.convertTo(IR_GPU_32F, CV_32F);
 
-    cv::cuda::GpuMat fused_TV_GPU, fused_IR_GPU, result_GPU;
+    cv::cuda::GpuMat fused_TV_GPU(gpu), fused_IR_GPU(gpu), result_GPU(gpu);
     cv::cuda::multiply(weight_TV_blur_GPU, TV_GPU_32F, fused_TV_GPU);
     cv::cuda::multiply(weight_IR_blur_GPU, IR_GPU_32F, fused_IR_GPU);
     cv::cuda::add(fused_TV_GPU, fused_IR_GPU, result_GPU);
 
-    cv::cuda::GpuMat resultNorm_GPU;
+    cv::cuda::GpuMat resultNorm_GPU(gpu);
     cv::cuda::normalize(result_GPU, resultNorm_GPU, 0, 255, cv::NORM_MINMAX, CV_32F);
     resultNorm_GPU.convertTo(resultNorm_GPU, CV_8U);
 
-    cv::cuda::GpuMat TV_Color_BGR_GPU, TV_HSV_GPU;
+    cv::cuda::GpuMat TV_Color_BGR_GPU(gpu), TV_HSV_GPU(gpu);
     TV_Color_BGR_GPU.upload(TV_Color_BGR);
     cv::cuda::cvtColor(TV_Color_BGR_GPU, TV_HSV_GPU, cv::COLOR_BGR2HSV);
 
-    std::vector<cv::cuda::GpuMat> hsvChannels(3);
+    cv::cuda::GpuMat hsvChannels[3] = {cv::cuda::GpuMat(gpu), cv::cuda::GpuMat(gpu), cv::cuda::GpuMat(gpu)};
     cv::cuda::split(TV_HSV_GPU, hsvChannels);
 
-    cv::cuda::GpuMat resizedResult_GPU;
+    cv::cuda::GpuMat resizedResult_GPU(gpu);
     resizedResult_GPU = resultNorm_GPU;
     resizedResult_GPU.copyTo(hsvChannels[2]);
 
-    cv::Mat irMask_CPU;
-    cv::threshold(IR_CPU_8U, irMask_CPU, adaptiveThreshold(TV_Color_BGR), 255, cv::THRESH_BINARY);
-    cv::cuda::GpuMat irMask_GPU;
+    timer.begin(FusionTimings::Mask);
+    cv::Mat irMask_CPU = arena.mat();
+    if (options.mask.mode == MaskMode::Global)
+        cv::threshold(IR_CPU_8U, irMask_CPU, adaptiveThreshold(TV_Color_BGR), 255, cv::THRESH_BINARY);
+    else
+        IRMask::buildMask(IR_CPU_8U, irStats, options.mask,
+                          options.kernels ? *options.kernels : FusionKernels::select(IR_CPU_8U.size()),
+                          irMask_CPU);
+    cv::cuda::GpuMat irMask_GPU(gpu);
     irMask_GPU.upload(irMask_CPU);
 
     hsvChannels[1].setTo(cv::Scalar(0), irMask_GPU);
 
-    cv::cuda::merge(hsvChannels, TV_HSV_GPU);
+    timer.begin(FusionTimings::Blend);
+    cv::cuda::merge(hsvChannels, 3, TV_HSV_GPU);
     cv::cuda::cvtColor(TV_HSV_GPU, TV_Color_BGR_GPU, cv::COLOR_HSV2BGR);
 
-    cv::Mat resultColor;
-    TV_Color_BGR_GPU.download(resultColor);
-    return resultColor;
+    TV_Color_BGR_GPU.download(result);
 }
 
-cv::Mat ImageFusion::fuseImagesHalf(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U) {
-    cv::cuda::GpuMat TV_GPU_8U(TV_CPU_8U), IR_GPU_8U(IR_CPU_8U), RES_GPU_8U;
+void ImageFusion::fuseImagesHalf(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U, cv::OutputArray result) {
+    cv::cuda::GpuMat::Allocator* gpu = FrameArena::local().device();
+    cv::cuda::GpuMat TV_GPU_8U(TV_CPU_8U, gpu), IR_GPU_8U(IR_CPU_8U, gpu), RES_GPU_8U(gpu);
     cv::cuda::addWeighted(IR_GPU_8U, 0.5, TV_GPU_8U, 0.5, 0.0, RES_GPU_8U);
-    cv::Mat RES_CPU_8U;
-    RES_GPU_8U.download(RES_CPU_8U);
-    return RES_CPU_8U;
+    RES_GPU_8U.download(result);
 }
 
-cv::Mat ImageFusion::fuseImagesMax(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U) {
-    cv::cuda::GpuMat TV_GPU(TV_CPU_8U), IR_GPU(IR_CPU_8U), RES_GPU;
+void ImageFusion::fuseImagesMax(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U, cv::OutputArray result) {
+    cv::cuda::GpuMat::Allocator* gpu = FrameArena::local().device();
+    cv::cuda::GpuMat TV_GPU(TV_CPU_8U, gpu), IR_GPU(IR_CPU_8U, gpu), RES_GPU(gpu);
     cv::cuda::max(TV_GPU, IR_GPU, RES_GPU);
-    cv::Mat RES_CPU;
-    RES_GPU.download(RES_CPU);
-    return RES_CPU;
+    RES_GPU.download(result);
 }
 
-cv::Mat ImageFusion::fuseImagesByMask(cv::Mat& TV_CPU_8U, cv::Mat& IR_CPU_8U) {
+void ImageFusion::fuseImagesByMask(const cv::Mat& TV_CPU_8U, const cv::Mat& IR_CPU_8U, cv::OutputArray result) {
+    cv::cuda::GpuMat::Allocator* gpu = FrameArena::local().device();
     const int T = 30;
-    cv::cuda::GpuMat TV_GPU(TV_CPU_8U);
-    cv::cuda::GpuMat IR_GPU(IR_CPU_8U);
-    cv::cuda::GpuMat diff_GPU;
+    cv::cuda::GpuMat TV_GPU(TV_CPU_8U, gpu);
+    cv::cuda::GpuMat IR_GPU(IR_CPU_8U, gpu);
+    cv::cuda::GpuMat diff_GPU(gpu);
     cv::cuda::absdiff(TV_GPU, IR_GPU, diff_GPU);
-    cv::cuda::GpuMat mask_GPU;
+    cv::cuda::GpuMat mask_GPU(gpu);
     cv::cuda::compare(diff_GPU, T, mask_GPU, cv::CMP_GT);
-    cv::cuda::GpuMat RES_GPU = TV_GPU.clone();
+    cv::cuda::GpuMat RES_GPU(gpu);
+    TV_GPU.copyTo(RES_GPU);
     IR_GPU.copyTo(RES_GPU, mask_GPU);
-    cv::Mat RES_CPU;
-    RES_GPU.download(RES_CPU);
-    return RES_CPU;
+    RES_GPU.download(result);
 }
 
-cv::Mat ImageFusion::fuseImagesWavelet(cv::Mat& TV, cv::Mat& IR) {
-    int rows = TV.rows, cols = TV.cols;
-    cv::Mat tvF, irF, lowTV(rows/2, cols/2, CV_32F), highTV(rows/2, cols/2, CV_32F),
-        lowIR(rows/2, cols/2, CV_32F), highIR(rows/2, cols/2, CV_32F);
-
-    TV.convertTo(tvF, CV_32F);
-    IR.convertTo(irF, CV_32F);
-
-    for(int i = 0; i < rows; i += 2)
-        for(int j = 0; j < cols; j += 2) {
-            float a = tvF.at<float>(i,j), b = tvF.at<float>(i,j+1),
-                c = tvF.at<float>(i+1,j), d = tvF.at<float>(i+1,j+1);
-            lowTV.at<float>(i/2, j/2) = (a + b + c + d) / 4;
-            highTV.at<float>(i/2, j/2) = std::fabs(a - b - c + d);
-
-            a = irF.at<float>(i,j); b = irF.at<float>(i,j+1);
-            c = irF.at<float>(i+1,j); d = irF.at<float>(i+1,j+1);
-            lowIR.at<float>(i/2, j/2) = (a + b + c + d) / 4;
-            highIR.at<float>(i/2, j/2) = std::fabs(a - b - c + d);
-        }
-
-    cv::Mat lowF, highF;
-    cv::max(lowTV, lowIR, lowF);
-    cv::max(highTV, highIR, highF);
-
-    cv::Mat result(rows, cols, CV_32F);
-    for(int i = 0; i < rows; i += 2)
-        for(int j = 0; j < cols; j += 2) {
-            float l = lowF.at<float>(i/2, j/2), h = highF.at<float>(i/2, j/2);
-            result.at<float>(i,j) = l + h;
-            result.at<float>(i,j+1) = l - h;
-            result.at<float>(i+1,j) = l - h;
-            result.at<float>(i+1,j+1) = l + h;
-        }
-
-    cv::normalize(result, result, 0, 255, cv::NORM_MINMAX);
-    result.convertTo(result, CV_8U);
-    return result;
+void ImageFusion::fuseImagesWavelet(const cv::Mat& TV, const cv::Mat& IR, cv::OutputArray result) {
+    fuseImagesWavelet(TV, IR, FusionKernels::select(TV.size()), result);
 }
 
-void ImageFusion::processTestFolders() {
-    QString path = "P:/tests";
-    const QStringList algNames = {"EPTDAC", "Half", "Max", "ByMask", "Wavelet"};
-    int algCount = algNames.size();
-
-    struct Acc { Metrics sum; int cnt = 0; };
-    QMap<QString, Acc> accum;
-    for (const QString& name : algNames) accum[name] = Acc();
-
-    for (int i = 1; i <= 9; ++i) {
-        if (i == 5) continue;
-        QString folder = path + "/" + QString::number(i);
-        QString tvFolder = folder + "/" + QString::number(i) + "_TV.bmp";
-        QString irFolder = folder + "/" + QString::number(i) + "_IR.bmp";
-        cv::Mat tv = cv::imread(tvFolder.toStdString(), cv::IMREAD_GRAYSCALE);
-        cv::Mat ir = cv::imread(irFolder.toStdString(), cv::IMREAD_GRAYSCALE);
-
-        QVector<cv::Mat> fused = {
-            ImageFusion::fuseImagesEPTDAC(tv, ir, {}, {}),
-            ImageFusion::fuseImagesHalf(tv, ir),
-            ImageFusion::fuseImagesMax(tv, ir),
-            ImageFusion::fuseImagesByMask(tv, ir),
-            ImageFusion::fuseImagesWavelet(tv, ir)
-        };
-
-        for (int k = 0; k < algCount; ++k) {
-            const QString& name = algNames[k];
-            Metrics m = QualityMetrics::eval(fused[k], ir, tv);
-            auto &acc = accum[name];
-            acc.cnt++;
-            acc.sum.EN        += m.EN;
-            acc.sum.SF        += m.SF;
-            acc.sum.AG        += m.AG;
-            acc.sum.SD        += m.SD;
-            acc.sum.EIN       += m.EIN;
-            acc.sum.SSIM_IR   += m.SSIM_IR;
-            acc.sum.SSIM_TV   += m.SSIM_TV;
-        }
+void ImageFusion::fuseImagesWavelet(const cv::Mat& TV, const cv::Mat& IR, const FusionKernels& kernels,
+                                    cv::OutputArray result) {
+    CV_Assert(TV.size() == IR.size() && TV.channels() == 1 && IR.channels() == 1);
+    CV_Assert(TV.rows >= 2 && TV.cols >= 2);
+
+    FrameArena& arena = FrameArena::local();
+    cv::Mat resultF = arena.mat();
+    resultF.create(TV.size(), CV_32F);
+
+    float minValue, maxValue;
+    if (TV.type() == CV_8UC1 && IR.type() == CV_8UC1) {
+        const FusionKernels& k = kernels.size == TV.size() ? kernels : FusionKernels::generic();
+        k.wavelet(TV, IR, resultF, minValue, maxValue);
+    } else {
+        cv::Mat tvF = arena.mat(), irF = arena.mat();
+        TV.convertTo(tvF, CV_32F);
+        IR.convertTo(irF, CV_32F);
+        FusionKernels::waveletGeneric32F(tvF, irF, resultF, minValue, maxValue);
     }
 
-    for (const QString& name : algNames) {
-        const auto& acc = accum[name];
-        if (acc.cnt == 0) continue;
-        double n = acc.cnt;
-        double avgSSIM = (acc.sum.SSIM_IR + acc.sum.SSIM_TV) / (2 * n);
-        Metrics avg = {
-            acc.sum.EN / n,
-            acc.sum.SF / n,
-            acc.sum.AG / n,
-            acc.sum.SD / n,
-            acc.sum.EIN / n
-        };
-        qDebug() << name << ":"
-                 << "EN="        << avg.EN
-                 << "SF="        << avg.SF
-                 << "AG="        << avg.AG
-                 << "SD="        << avg.SD
-                 << "EIN="       << avg.EIN
-                 << "Avg SSIM="  << avgSSIM;
-    }
+    const double range = maxValue - minValue;
+    const double scale = range > DBL_EPSILON ? 255.0 / range : 0.0;
+    resultF.convertTo(result, CV_8U, scale, -minValue * scale);
+}
+
+cv::Mat ImageFusion::fuseImagesEPTDAC(const cv::Mat& TV, const cv::Mat& IR,
+                                     const std::vector<cv::Point2f>& tvPoints,
+                                     const std::vector<cv::Point2f>& irPoints,
+                                     const FusionOptions& options) {
+    cv::Mat result;
+    fuseImagesEPTDAC(TV, IR, tvPoints, irPoints, result, options);
+    return result;
+}
+
+cv::Mat ImageFusion::fuseImagesEPTDAC_RGB(const cv::Mat& TV, const cv::Mat& IR,
+                                         const std::vector<cv::Point2f>& tvPoints,
+                                         const std::vector<cv::Point2f>& irPoints,
+                                         const FusionOptions& options) {
+    cv::Mat result;
+    fuseImagesEPTDAC_RGB(TV, IR, tvPoints, irPoints, result, options);
+    return result;
+}
+
+cv::Mat ImageFusion::fuseImagesHalf(const cv::Mat& TV, const cv::Mat& IR) {
+    cv::Mat result;
+    fuseImagesHalf(TV, IR, result);
+    return result;
+}
+
+cv::Mat ImageFusion::fuseImagesMax(const cv::Mat& TV, const cv::Mat& IR) {
+    cv::Mat result;
+    fuseImagesMax(TV, IR, result);
+    return result;
+}
+
+cv::Mat ImageFusion::fuseImagesByMask(const cv::Mat& TV, const cv::Mat& IR) {
+    cv::Mat result;
+    fuseImagesByMask(TV, IR, result);
+    return result;
+}
+
+cv::Mat ImageFusion::fuseImagesWavelet(const cv::Mat& TV, const cv::Mat& IR) {
+    cv::Mat result;
+    fuseImagesWavelet(TV, IR, result);
+    return result;
+}
+
+cv::Mat ImageFusion::fuseImagesWavelet(const cv::Mat& TV, const cv::Mat& IR, const FusionKernels& kernels) {
+    cv::Mat result;
+    fuseImagesWavelet(TV, IR, kernels, result);
+    return result;
 }
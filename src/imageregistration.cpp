@@ -0,0 +1,159 @@
+#include "imageregistration.h"
+#include "framearena.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int MIN_PYRAMID_SIDE = 32;
+const int ECC_GAUSS_SIZE = 5;
+
+} // namespace
+
+ImageRegistration::ImageRegistration(const RegistrationParams& params)
+    : params(params)
+{
+}
+
+void ImageRegistration::reset()
+{
+    warp = cv::Matx33f::eye();
+    hasWarp = false;
+    coarseCorrelation = 0;
+    lastCorrelation = 0;
+    refined = false;
+    retryCountdown = 0;
+    rejectedCorrelation = 0;
+}
+
+cv::Mat ImageRegistration::estimate(const cv::Mat& tv, const cv::Mat& ir)
+{
+    CV_Assert(!tv.empty() && !ir.empty());
+
+    int levels = std::max(params.pyramidLevels, 1);
+    const int minSide = std::min({tv.cols, tv.rows, ir.cols, ir.rows});
+    while (levels > 1 && (minSide >> (levels - 1)) < MIN_PYRAMID_SIDE)
+        --levels;
+    const int coarsest = levels - 1;
+    const int finest = std::clamp(params.finestLevel, 0, coarsest);
+    const double coarseScale = 1.0 / (1 << coarsest);
+
+    // Edge maps are built per level on demand: a frame that passes the
+    // coarse check never pays for the finer ones.
+    const cv::Mat tvGray = toGray(tv), irGray = toGray(ir);
+    downsample(tvGray, levels, tvPyr);
+    downsample(irGray, levels, irPyr);
+    auto tvLevel = [&](int level) -> const cv::Mat& { return level == 0 ? tvGray : tvPyr[level]; };
+    auto irLevel = [&](int level) -> const cv::Mat& { return level == 0 ? irGray : irPyr[level]; };
+    const cv::Mat tvCoarse = edgeMap(tvLevel(coarsest)), irCoarse = edgeMap(irLevel(coarsest));
+
+    double startCorrelation = 0;
+    if (hasWarp || retryCountdown > 0) {
+        startCorrelation = correlationAt(tvCoarse, irCoarse, scaleWarp(warp, coarseScale));
+        refined = false;
+        if (hasWarp && startCorrelation >= coarseCorrelation - params.refineDrop)
+            return homography();
+        // Back off after a rejected refinement: ECC on a pair it cannot
+        // register would otherwise run on every frame.
+        if (retryCountdown > 0 && std::abs(startCorrelation - rejectedCorrelation) < params.refineDrop) {
+            --retryCountdown;
+            return homography();
+        }
+    }
+
+    const cv::TermCriteria criteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS,
+                                    params.maxIterations, params.epsilon);
+    cv::Mat w(scaleWarp(warp, coarseScale));
+    double rho = 0;
+    for (int level = coarsest; level >= finest; --level) {
+        const cv::Mat tvEdges = level == coarsest ? tvCoarse : edgeMap(tvLevel(level));
+        const cv::Mat irEdges = level == coarsest ? irCoarse : edgeMap(irLevel(level));
+        cv::Mat start = w.clone();
+        try {
+            rho = cv::findTransformECC(tvEdges, irEdges, w, cv::MOTION_HOMOGRAPHY,
+                                       criteria, cv::noArray(), ECC_GAUSS_SIZE);
+        } catch (const cv::Exception&) {
+            w = start;
+        }
+        if (level > finest)
+            w = cv::Mat(scaleWarp(cv::Matx33f(w), 2.0));
+    }
+
+    // A rejected refinement keeps the previous warp, or none at all, so later
+    // frames check against the last accepted state and retry once the backoff
+    // runs out instead of settling on an identity that was never verified.
+    refined = rho >= params.minCorrelation;
+    if (refined) {
+        warp = scaleWarp(cv::Matx33f(w), static_cast<double>(1 << finest));
+        hasWarp = true;
+        lastCorrelation = rho;
+        coarseCorrelation = correlationAt(tvCoarse, irCoarse, scaleWarp(warp, coarseScale));
+        retryCountdown = 0;
+    } else {
+        if (!hasWarp && retryCountdown == 0)
+            startCorrelation = correlationAt(tvCoarse, irCoarse, scaleWarp(warp, coarseScale));
+        retryCountdown = std::max(params.retryInterval, 0);
+        rejectedCorrelation = startCorrelation;
+    }
+    return homography();
+}
+
+cv::Mat ImageRegistration::toGray(const cv::Mat& img)
+{
+    if (img.channels() == 1)
+        return img;
+    cv::Mat gray = FrameArena::local().mat();
+    cv::cvtColor(img, gray, img.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    return gray;
+}
+
+void ImageRegistration::downsample(const cv::Mat& gray, int levels, std::vector<cv::Mat>& pyramid)
+{
+    // Default-allocated on purpose: the pyramid outlives the call and may be
+    // used from another thread next time, which arena memory must not be.
+    pyramid.resize(std::max<size_t>(pyramid.size(), levels));
+    for (int level = 1; level < levels; ++level)
+        cv::pyrDown(level == 1 ? gray : pyramid[level - 1], pyramid[level]);
+}
+
+cv::Mat ImageRegistration::edgeMap(const cv::Mat& img)
+{
+    FrameArena& arena = FrameArena::local();
+    cv::Mat f = arena.mat();
+    img.convertTo(f, CV_32F);
+    cv::GaussianBlur(f, f, cv::Size(3, 3), 0);
+
+    cv::Mat dx = arena.mat(), dy = arena.mat(), mag = arena.mat();
+    cv::Sobel(f, dx, CV_32F, 1, 0, 3);
+    cv::Sobel(f, dy, CV_32F, 0, 1, 3);
+    cv::magnitude(dx, dy, mag);
+    cv::normalize(mag, mag, 0.0, 1.0, cv::NORM_MINMAX);
+    return mag;
+}
+
+cv::Matx33f ImageRegistration::scaleWarp(const cv::Matx33f& warp, double scale)
+{
+    cv::Matx33f scaled = warp;
+    scaled(0, 2) *= static_cast<float>(scale);
+    scaled(1, 2) *= static_cast<float>(scale);
+    scaled(2, 0) /= static_cast<float>(scale);
+    scaled(2, 1) /= static_cast<float>(scale);
+    return scaled;
+}
+
+double ImageRegistration::correlationAt(const cv::Mat& tvEdges, const cv::Mat& irEdges, const cv::Matx33f& warp)
+{
+    cv::Mat warped = FrameArena::local().mat();
+    cv::warpPerspective(irEdges, warped, warp, tvEdges.size(), cv::INTER_LINEAR | cv::WARP_INVERSE_MAP);
+    return cv::computeECC(tvEdges, warped);
+}
+
+cv::Mat ImageRegistration::homography() const
+{
+    if (!hasWarp)
+        return cv::Mat::eye(3, 3, CV_64F);
+
+    const cv::Matx33d H = cv::Matx33d(warp).inv();
+    return cv::Mat(H * (1.0 / H(2, 2)));
+}
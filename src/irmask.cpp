@@ -0,0 +1,184 @@
+#include "irmask.h"
+#include "framearena.h"
+#include "fusionkernels.h"
+
+#include <opencv2/core/utility.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+double otsuFromHist(const int* hist, int total, double sum)
+{
+    double sumB = 0, maxVar = -1;
+    int wB = 0, best = 0;
+    for (int t = 0; t < 256; ++t) {
+        wB += hist[t];
+        if (wB == 0)
+            continue;
+        const int wF = total - wB;
+        if (wF == 0)
+            break;
+        sumB += static_cast<double>(t) * hist[t];
+        const double mB = sumB / wB, mF = (sum - sumB) / wF;
+        const double var = static_cast<double>(wB) * wF * (mB - mF) * (mB - mF);
+        if (var > maxVar) {
+            maxVar = var;
+            best = t;
+        }
+    }
+    return best;
+}
+
+// Tile index pair and weight for bilinear interpolation between tile centres.
+void interpTable(int len, int tiles, std::vector<int>& i0, std::vector<int>& i1, std::vector<float>& w)
+{
+    i0.resize(len);
+    i1.resize(len);
+    w.resize(len);
+    const double tileLen = static_cast<double>(len) / tiles;
+    for (int p = 0; p < len; ++p) {
+        const double u = (p + 0.5) / tileLen - 0.5;
+        const int lo = std::clamp(static_cast<int>(std::floor(u)), 0, tiles - 1);
+        i0[p] = lo;
+        i1[p] = std::min(lo + 1, tiles - 1);
+        w[p] = static_cast<float>(std::clamp(u - lo, 0.0, 1.0));
+    }
+}
+
+struct InterpTables {
+    std::vector<int> cx0, cx1, ry0, ry1;
+    std::vector<float> cw, rw;
+};
+
+} // namespace
+
+IRStatistics IRMask::computeStatistics(const cv::Mat& ir, cv::Size grid)
+{
+    IRStatistics stats;
+    computeStatistics(ir, grid, stats, true);
+    return stats;
+}
+
+void IRMask::computeStatistics(const cv::Mat& ir, cv::Size grid, IRStatistics& stats, bool otsu)
+{
+    CV_Assert(!ir.empty() && ir.type() == CV_8UC1);
+
+    stats.grid = cv::Size(std::clamp(grid.width, 1, ir.cols), std::clamp(grid.height, 1, ir.rows));
+    const int gx = stats.grid.width, gy = stats.grid.height;
+
+    stats.tileMean.create(gy, gx, CV_32F);
+    stats.tileStdDev.create(gy, gx, CV_32F);
+    if (otsu)
+        stats.tileOtsu.create(gy, gx, CV_32F);
+    stats.hasOtsu = otsu;
+    // Per-tile sum and sum of squares; exact in double up to 2^53, far beyond 255^2 per pixel of any tile.
+    cv::Mat tileSums = FrameArena::local().mat();
+    tileSums.create(gx * gy, 2, CV_64F);
+
+    cv::parallel_for_(cv::Range(0, gx * gy), [&](const cv::Range& range) {
+        for (int t = range.start; t < range.end; ++t) {
+            const int tx = t % gx, ty = t / gx;
+            const int x0 = tx * ir.cols / gx, x1 = (tx + 1) * ir.cols / gx;
+            const int y0 = ty * ir.rows / gy, y1 = (ty + 1) * ir.rows / gy;
+
+            const int count = (x1 - x0) * (y1 - y0);
+
+            double sum, sqSum;
+            if (otsu) {
+                int hist[256] = {};
+                for (int y = y0; y < y1; ++y) {
+                    const uchar* row = ir.ptr<uchar>(y);
+                    for (int x = x0; x < x1; ++x)
+                        ++hist[row[x]];
+                }
+                int64_t s = 0, sq = 0;
+                for (int v = 0; v < 256; ++v) {
+                    s += static_cast<int64_t>(v) * hist[v];
+                    sq += static_cast<int64_t>(v) * v * hist[v];
+                }
+                sum = static_cast<double>(s);
+                sqSum = static_cast<double>(sq);
+                stats.tileOtsu.at<float>(ty, tx) = static_cast<float>(otsuFromHist(hist, count, sum));
+            } else {
+                // Vectorised in OpenCV and exact for 8-bit input.
+                const cv::Mat tile = ir(cv::Range(y0, y1), cv::Range(x0, x1));
+                sum = cv::sum(tile)[0];
+                sqSum = cv::norm(tile, cv::NORM_L2SQR);
+            }
+            const double mean = sum / count;
+            const double var = std::max(sqSum / count - mean * mean, 0.0);
+
+            stats.tileMean.at<float>(ty, tx) = static_cast<float>(mean);
+            stats.tileStdDev.at<float>(ty, tx) = static_cast<float>(std::sqrt(var));
+            tileSums.at<double>(t, 0) = sum;
+            tileSums.at<double>(t, 1) = sqSum;
+        }
+    });
+
+    int64_t sum = 0, sqSum = 0;
+    for (int t = 0; t < gx * gy; ++t) {
+        sum += static_cast<int64_t>(tileSums.at<double>(t, 0));
+        sqSum += static_cast<int64_t>(tileSums.at<double>(t, 1));
+    }
+    const double n = static_cast<double>(ir.total());
+    stats.mean = sum / n;
+    stats.stddev = std::sqrt(std::max(sqSum / n - stats.mean * stats.mean, 0.0));
+}
+
+void IRMask::tileThresholds(const IRStatistics& stats, const MaskParams& params, cv::Mat& thresholds)
+{
+    thresholds.create(stats.grid, CV_32F);
+    for (int ty = 0; ty < stats.grid.height; ++ty)
+        for (int tx = 0; tx < stats.grid.width; ++tx) {
+            const double mean = stats.tileMean.at<float>(ty, tx);
+            const double stddev = stats.tileStdDev.at<float>(ty, tx);
+            double t;
+            if (stddev < params.minStdDev)
+                t = mean + params.k * params.minStdDev;
+            else if (params.mode == MaskMode::LocalOtsu) {
+                CV_Assert(stats.hasOtsu);
+                t = stats.tileOtsu.at<float>(ty, tx);
+            }
+            else
+                t = mean + params.k * stddev;
+            thresholds.at<float>(ty, tx) = static_cast<float>(std::max(t, stats.mean));
+        }
+}
+
+void IRMask::buildMask(const cv::Mat& ir, const IRStatistics& stats,
+                       const MaskParams& params, const FusionKernels& kernels, cv::Mat& mask)
+{
+    CV_Assert(ir.type() == CV_8UC1);
+
+    cv::Mat thresholds = FrameArena::local().mat();
+    tileThresholds(stats, params, thresholds);
+    const int gx = stats.grid.width, gy = stats.grid.height;
+
+    // Bound to a reference so the workers below see this thread's tables.
+    thread_local InterpTables tablesCache;
+    InterpTables& tables = tablesCache;
+    interpTable(ir.cols, gx, tables.cx0, tables.cx1, tables.cw);
+    interpTable(ir.rows, gy, tables.ry0, tables.ry1, tables.rw);
+
+    const FusionKernels::MaskRowFn maskRow =
+        (kernels.size == ir.size() ? kernels : FusionKernels::generic()).maskRow;
+
+    mask.create(ir.size(), CV_8UC1);
+    cv::parallel_for_(cv::Range(0, ir.rows), [&](const cv::Range& range) {
+        thread_local std::vector<float> rowT;
+        rowT.resize(gx);
+        for (int y = range.start; y < range.end; ++y) {
+            const float* t0 = thresholds.ptr<float>(tables.ry0[y]);
+            const float* t1 = thresholds.ptr<float>(tables.ry1[y]);
+            for (int tx = 0; tx < gx; ++tx)
+                rowT[tx] = t0[tx] + (t1[tx] - t0[tx]) * tables.rw[y];
+
+            maskRow(ir.ptr<uchar>(y), mask.ptr<uchar>(y), rowT.data(),
+                    tables.cx0.data(), tables.cx1.data(), tables.cw.data(), ir.cols);
+        }
+    });
+}
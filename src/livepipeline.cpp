@@ -0,0 +1,147 @@
+#include "livepipeline.h"
+#include "imageregistration.h"
+#include "fusionkernels.h"
+
+#include <algorithm>
+#include <chrono>
+
+FileReplaySource::FileReplaySource(const std::vector<std::string>& files)
+{
+    for (const std::string& file : files) {
+        cv::Mat img = cv::imread(file, cv::IMREAD_GRAYSCALE);
+        if (!img.empty())
+            frames.push_back(img);
+    }
+    CV_Assert(!frames.empty());
+}
+
+cv::Mat FileReplaySource::frameAt(double)
+{
+    cv::Mat frame = frames[next];
+    next = (next + 1) % frames.size();
+    return frame;
+}
+
+CameraFeed::CameraFeed(std::unique_ptr<FrameSource> source, double rateHz, Sink sink)
+    : source(std::move(source)), rateHz(rateHz), sink(std::move(sink))
+{
+    CV_Assert(rateHz > 0);
+}
+
+CameraFeed::~CameraFeed()
+{
+    stop();
+}
+
+void CameraFeed::start()
+{
+    if (running.exchange(true))
+        return;
+    // run() clears running on its own when the source ends, leaving the thread joinable.
+    if (thread.joinable())
+        thread.join();
+    thread = std::thread(&CameraFeed::run, this);
+}
+
+void CameraFeed::stop()
+{
+    running = false;
+    if (thread.joinable())
+        thread.join();
+}
+
+void CameraFeed::run()
+{
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rateHz));
+    const Clock::time_point origin = Clock::now();
+
+    for (uint64_t sequence = 0; running; ++sequence) {
+        const Clock::time_point tick = origin + period * static_cast<Clock::rep>(sequence);
+        std::this_thread::sleep_until(tick);
+
+        TimestampedFrame frame;
+        frame.image = source->frameAt(sequence / rateHz);
+        if (frame.image.empty())
+            break;
+        frame.captureNs = std::chrono::duration_cast<std::chrono::nanoseconds>(tick.time_since_epoch()).count();
+        frame.sequence = sequence;
+        sink(std::move(frame));
+    }
+    running = false;
+}
+
+LivePipeline::LivePipeline(std::unique_ptr<FrameSource> irSource, double irRateHz,
+                           std::unique_ptr<FrameSource> tvSource, double tvRateHz,
+                           FuseFn fuse, OutputFn output, const SyncParams& params)
+    : sync(params),
+      irFeed(std::move(irSource), irRateHz, [this](TimestampedFrame&& f) { sync.pushIR(std::move(f)); }),
+      tvFeed(std::move(tvSource), tvRateHz, [this](TimestampedFrame&& f) { sync.pushTV(std::move(f)); }),
+      fuse(std::move(fuse)),
+      output(std::move(output))
+{
+    CV_Assert(this->fuse);
+}
+
+LivePipeline::~LivePipeline()
+{
+    stop();
+}
+
+LivePipeline::FuseFn LivePipeline::eptdacFusion(cv::Size frameSize, const MaskParams& mask)
+{
+    // Only the consumer thread calls fuse, so the registration needs no lock.
+    auto registration = std::make_shared<ImageRegistration>();
+    FusionOptions options;
+    options.mask = mask;
+    options.registration = registration.get();
+    options.kernels = &FusionKernels::select(frameSize);
+    return [registration, options](const cv::Mat& tv, const cv::Mat& ir) {
+        return ImageFusion::fuseImagesEPTDAC_RGB(tv, ir, {}, {}, options);
+    };
+}
+
+void LivePipeline::start()
+{
+    if (running.exchange(true))
+        return;
+    consumer = std::thread(&LivePipeline::consume, this);
+    irFeed.start();
+    tvFeed.start();
+}
+
+void LivePipeline::stop()
+{
+    irFeed.stop();
+    tvFeed.stop();
+    running = false;
+    if (consumer.joinable())
+        consumer.join();
+}
+
+PipelineStats LivePipeline::stats() const
+{
+    PipelineStats s;
+    s.sync = sync.counters();
+    s.fused = fused.load(std::memory_order_relaxed);
+    s.latency = latency.summary();
+    return s;
+}
+
+void LivePipeline::consume()
+{
+    FramePair pair;
+    while (running) {
+        if (!sync.nextPair(pair)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(250));
+            continue;
+        }
+
+        cv::Mat result = fuse(pair.tv.image, pair.ir.image);
+        if (output)
+            output(result, pair);
+
+        latency.record(steadyNowNs() - std::min(pair.ir.captureNs, pair.tv.captureNs));
+        fused.fetch_add(1, std::memory_order_relaxed);
+    }
+}
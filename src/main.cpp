@@ -1,11 +1,11 @@
 #include "mainwindow.h"
-#include "imagefusion.h"
+#include "batchprocessing.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
-    ImageFusion::processTestFolders();
+    BatchProcessing::processTestFolders();
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -8,6 +8,7 @@
 #include <QMessageBox>
 #include <QImage>
 #include <QPixmap>
+#include <QtConcurrent/QtConcurrentRun>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
@@ -38,6 +39,8 @@ MainWindow::MainWindow(QWidget *parent)
     connect(btnRunComplexing, &QPushButton::clicked, this, &MainWindow::runFusion);
     connect(btnSaveResult, &QPushButton::clicked, this, &MainWindow::saveImageRes);
     connect(btnClearPoints, &QPushButton::clicked, this, &MainWindow::clearAllPoints);
+    connect(&refineWatcher, &QFutureWatcher<RefinementResult>::finished, this, &MainWindow::refinementFinished);
+    refinePool.setMaxThreadCount(1);
 
     QHBoxLayout* imagesLayout = new QHBoxLayout;
     imagesLayout->addWidget(widgetTVImage);
@@ -63,6 +66,11 @@ MainWindow::MainWindow(QWidget *parent)
     resize(1000, 400);
 }
 
+MainWindow::~MainWindow()
+{
+    refineWatcher.waitForFinished();
+}
+
 void MainWindow::loadImageTV()
 {
     QString fileName = QFileDialog::getOpenFileName(this, "Open TV Image", QString(), "Images (*.png *.jpg *.bmp)");
@@ -76,6 +84,7 @@ void MainWindow::loadImageTV()
 
     showMatOnWidget(imgTV, widgetTVImage);
     widgetTVImage->clearPoints();
+    invalidateResult();
 }
 
 void MainWindow::loadImageIR()
@@ -91,10 +100,17 @@ void MainWindow::loadImageIR()
 
     showMatOnWidget(imgIR, widgetIRImage);
     widgetIRImage->clearPoints();
+    invalidateResult();
 }
 
 void MainWindow::saveImageRes()
 {
+    if (refineWatcher.isRunning() || refinePending)
+    {
+        QMessageBox::warning(this, "Error", "Full-resolution result is still being computed");
+        return;
+    }
+
     if (imgRes.empty())
     {
         QMessageBox::warning(this, "Error", "No result image to save");
@@ -133,16 +149,122 @@ void MainWindow::runFusion()
     for (const QPointF& pt : irPoints)
         irCV.emplace_back(static_cast<float>(pt.x()), static_cast<float>(pt.y()));
 
+    ++fusionGeneration;
+    imgRes.release();
+    refineTVPoints = tvCV;
+    refineIRPoints = irCV;
+
     try {
-        imgRes = ImageFusion::fuseImagesEPTDAC_RGB(imgTV, imgIR, tvCV, irCV);
-    } catch (const cv::Exception& e) {
+        cv::Mat preview = fusePreview(tvCV, irCV);
+        if (!preview.empty())
+            showMatOnLabel(preview, labelResultImage);
+        else
+            labelResultImage->setText("Refining...");
+    } catch (const std::exception& e) {
         QMessageBox::warning(this, "Fusion Error", e.what());
         return;
     }
 
+    startRefinement();
+}
+
+cv::Mat MainWindow::fusePreview(const std::vector<cv::Point2f>& tvPoints, const std::vector<cv::Point2f>& irPoints)
+{
+    // Halve the TV image while it still covers the label. Nothing to preview
+    // when it is already that small: the refinement is just as fast.
+    const QSize target = labelResultImage->size();
+    if (imgTV.cols / 2 < target.width() || imgTV.rows / 2 < target.height())
+        return cv::Mat();
+
+    cv::Mat tv;
+    cv::pyrDown(imgTV, tv);
+    while (tv.cols / 2 >= target.width() && tv.rows / 2 >= target.height())
+        cv::pyrDown(tv, tv);
+
+    // fuseImagesEPTDAC_RGB resizes IR to the TV size before warping with the
+    // point homography, so both point sets scale with the TV image.
+    cv::Mat ir;
+    cv::resize(imgIR, ir, tv.size(), 0, 0, cv::INTER_AREA);
+    const float sx = static_cast<float>(tv.cols) / imgTV.cols;
+    const float sy = static_cast<float>(tv.rows) / imgTV.rows;
+    std::vector<cv::Point2f> tvScaled, irScaled;
+    for (const cv::Point2f& pt : tvPoints)
+        tvScaled.emplace_back(pt.x * sx, pt.y * sy);
+    for (const cv::Point2f& pt : irPoints)
+        irScaled.emplace_back(pt.x * sx, pt.y * sy);
+
+    FusionOptions options;
+    options.registration = &previewRegistration;
+    return ImageFusion::fuseImagesEPTDAC_RGB(tv, ir, tvScaled, irScaled, options);
+}
+
+void MainWindow::startRefinement()
+{
+    if (refineWatcher.isRunning()) {
+        refinePending = true;
+        return;
+    }
+    refinePending = false;
+
+    // The running refinement owns registration, so resets wait until it is done.
+    if (registrationStale) {
+        registration.reset();
+        registrationStale = false;
+    }
+
+    const cv::Mat tv = imgTV, ir = imgIR;
+    const std::vector<cv::Point2f> tvPoints = refineTVPoints, irPoints = refineIRPoints;
+    const quint64 generation = fusionGeneration;
+    ImageRegistration* reg = &registration;
+
+    refineWatcher.setFuture(QtConcurrent::run(&refinePool, [=]() {
+        RefinementResult result;
+        result.generation = generation;
+        try {
+            FusionOptions options;
+            options.registration = reg;
+            result.image = ImageFusion::fuseImagesEPTDAC_RGB(tv, ir, tvPoints, irPoints, options);
+        } catch (const std::exception& e) {
+            // Anything left to escape would be rethrown by result() on the UI thread.
+            result.error = QString::fromStdString(e.what());
+        } catch (...) {
+            result.error = "Unknown error during fusion";
+        }
+        return result;
+    }));
+}
+
+void MainWindow::refinementFinished()
+{
+    const RefinementResult result = refineWatcher.result();
+    if (refinePending) {
+        startRefinement();
+        return;
+    }
+    if (result.generation != fusionGeneration)
+        return;
+
+    if (!result.error.isEmpty()) {
+        labelResultImage->setText("No Image");
+        QMessageBox::warning(this, "Fusion Error", result.error);
+        return;
+    }
+
+    imgRes = result.image;
     showMatOnLabel(imgRes, labelResultImage);
 }
 
+void MainWindow::invalidateResult()
+{
+    ++fusionGeneration;
+    refinePending = false;
+    previewRegistration.reset();
+    if (refineWatcher.isRunning())
+        registrationStale = true;
+    else
+        registration.reset();
+}
+
 void MainWindow::showMatOnWidget(const cv::Mat& mat, CustomImageWidget* widget) {
     if (mat.empty())
         return;
@@ -173,5 +295,10 @@ QImage MainWindow::matToQImage(const cv::Mat& mat)
         return QImage(mat.data, mat.cols, mat.rows, static_cast<int>(mat.step), QImage::Format_Grayscale8).copy();
     }
 
+    if (mat.type() == CV_8UC3)
+    {
+        return QImage(mat.data, mat.cols, mat.rows, static_cast<int>(mat.step), QImage::Format_BGR888).copy();
+    }
+
     return QImage();
 }
@@ -1,10 +1,12 @@
 #include "qualitymetrics.h"
+#include "ssimengine.h"
+#include "framearena.h"
 
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 
 double QualityMetrics::computeEntropy(const cv::Mat& img) {
-    cv::Mat hist;
+    cv::Mat hist = FrameArena::local().mat();
     int histSize = 256;
     float range[] = {0, 256};
     const float* histRange = { range };
@@ -20,18 +22,22 @@ double QualityMetrics::computeEntropy(const cv::Mat& img) {
 }
 
 double QualityMetrics::computeSpatialFreq(const cv::Mat& img) {
-    cv::Mat dx, dy;
+    FrameArena& arena = FrameArena::local();
+    cv::Mat dx = arena.mat(), dy = arena.mat();
     cv::Sobel(img, dx, CV_32F, 1, 0);
     cv::Sobel(img, dy, CV_32F, 0, 1);
-    double sf = std::sqrt(cv::mean(dx.mul(dx))[0] + cv::mean(dy.mul(dy))[0]);
+    cv::multiply(dx, dx, dx);
+    cv::multiply(dy, dy, dy);
+    double sf = std::sqrt(cv::mean(dx)[0] + cv::mean(dy)[0]);
     return sf;
 }
 
 double QualityMetrics::computeAvgGrad(const cv::Mat& img) {
-    cv::Mat dx, dy;
+    FrameArena& arena = FrameArena::local();
+    cv::Mat dx = arena.mat(), dy = arena.mat();
     cv::Sobel(img, dx, CV_32F, 1, 0);
     cv::Sobel(img, dy, CV_32F, 0, 1);
-    cv::Mat grad;
+    cv::Mat grad = arena.mat();
     cv::magnitude(dx, dy, grad);
     return cv::mean(grad)[0];
 }
@@ -43,48 +49,15 @@ double QualityMetrics::computeStdDev(const cv::Mat& img) {
 }
 
 double QualityMetrics::computeEdgeIntensity(const cv::Mat& img) {
-    cv::Mat edges;
+    cv::Mat edges = FrameArena::local().mat();
     cv::Canny(img, edges, 50, 150);
     return cv::mean(edges)[0];
 }
 
 double QualityMetrics::computeSSIM(const cv::Mat& img1, const cv::Mat& img2) {
-    cv::Mat img1_f, img2_f;
-    img1.convertTo(img1_f, CV_32F);
-    img2.convertTo(img2_f, CV_32F);
-
-    cv::Mat mu1, mu2;
-    cv::GaussianBlur(img1_f, mu1, cv::Size(11, 11), 1.5);
-    cv::GaussianBlur(img2_f, mu2, cv::Size(11, 11), 1.5);
-
-    cv::Mat mu1_sq = mu1.mul(mu1);
-    cv::Mat mu2_sq = mu2.mul(mu2);
-    cv::Mat mu1_mu2 = mu1.mul(mu2);
-
-    cv::Mat sigma1_sq, sigma2_sq, sigma12;
-    cv::GaussianBlur(img1_f.mul(img1_f), sigma1_sq, cv::Size(11, 11), 1.5);
-    sigma1_sq -= mu1_sq;
-
-    cv::GaussianBlur(img2_f.mul(img2_f), sigma2_sq, cv::Size(11, 11), 1.5);
-    sigma2_sq -= mu2_sq;
-
-    cv::GaussianBlur(img1_f.mul(img2_f), sigma12, cv::Size(11, 11), 1.5);
-    sigma12 -= mu1_mu2;
-
-    const double C1 = 6.5025, C2 = 58.5225;
-    cv::Mat t1, t2, t3;
-
-    t1 = 2 * mu1_mu2 + C1;
-    t2 = 2 * sigma12 + C2;
-    t3 = t1.mul(t2);
-
-    t1 = mu1_sq + mu2_sq + C1;
-    t2 = sigma1_sq + sigma2_sq + C2;
-    t1 = t1.mul(t2);
-
-    cv::Mat ssim_map;
-    cv::divide(t3, t1, ssim_map);
-    return cv::mean(ssim_map)[0];
+    thread_local SSIMResult workspace;
+    SSIMEngine::compute(img1, img2, workspace);
+    return workspace.mssim;
 }
 
 Metrics QualityMetrics::eval(const cv::Mat& fused, const cv::Mat& ir, const cv::Mat& tv) {
@@ -0,0 +1,634 @@
+#include "regressionrunner.h"
+#include "syntheticscene.h"
+#include "ssimreference.h"
+#include "ssimengine.h"
+#include "imageregistration.h"
+#include "frameingest.h"
+#include "framearena.h"
+
+#include <opencv2/core/cuda.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+
+namespace {
+
+using FuseFn = void (*)(const cv::Mat& tv, const cv::Mat& ir, cv::Mat& result, const FusionOptions& options);
+
+// Buffers OpenCV takes from the default allocators by itself on every call,
+// with the fused output already reused. These are upper bounds: the
+// steady-state round fails when it takes more.
+const size_t CUDA_NORMALIZE_BUFFERS = 1;  // cuda::normalize(NORM_MINMAX): min/max result
+const size_t CANNY_BUFFERS = 3;           // Canny edge map plus dx/dy of its one stripe
+const size_t EVAL_BUFFERS = CANNY_BUFFERS;
+
+template <MaskMode Mode>
+void fuseRGBLocal(const cv::Mat& tv, const cv::Mat& ir, cv::Mat& result, const FusionOptions& options)
+{
+    FusionOptions local = options;
+    local.mask.mode = Mode;
+    ImageFusion::fuseImagesEPTDAC_RGB(tv, ir, {}, {}, result, local);
+}
+
+struct Algorithm {
+    const char* name;
+    FuseFn fuse;
+    size_t fuseBuffers;
+};
+
+const Algorithm ALGORITHMS[] = {
+    {"EPTDAC",           [](const cv::Mat& tv, const cv::Mat& ir, cv::Mat& r, const FusionOptions& o) { ImageFusion::fuseImagesEPTDAC(tv, ir, {}, {}, r, o); },
+                         2 * CUDA_NORMALIZE_BUFFERS},
+    {"EPTDAC_RGB",       [](const cv::Mat& tv, const cv::Mat& ir, cv::Mat& r, const FusionOptions& o) { ImageFusion::fuseImagesEPTDAC_RGB(tv, ir, {}, {}, r, o); },
+                         3 * CUDA_NORMALIZE_BUFFERS},
+    {"EPTDAC_RGB/local", fuseRGBLocal<MaskMode::LocalMeanStd>, 3 * CUDA_NORMALIZE_BUFFERS},
+    {"EPTDAC_RGB/otsu",  fuseRGBLocal<MaskMode::LocalOtsu>, 3 * CUDA_NORMALIZE_BUFFERS},
+    {"Half",             [](const cv::Mat& tv, const cv::Mat& ir, cv::Mat& r, const FusionOptions&) { ImageFusion::fuseImagesHalf(tv, ir, r); }, 0},
+    {"Max",              [](const cv::Mat& tv, const cv::Mat& ir, cv::Mat& r, const FusionOptions&) { ImageFusion::fuseImagesMax(tv, ir, r); }, 0},
+    {"ByMask",           [](const cv::Mat& tv, const cv::Mat& ir, cv::Mat& r, const FusionOptions&) { ImageFusion::fuseImagesByMask(tv, ir, r); }, 0},
+    {"Wavelet",          [](const cv::Mat& tv, const cv::Mat& ir, cv::Mat& r, const FusionOptions&) { ImageFusion::fuseImagesWavelet(tv, ir, r); }, 0},
+};
+
+const char* const STAGE_NAMES[FusionTimings::StageCount] = {"align", "edgeWeights", "mask", "blend"};
+
+struct MetricField {
+    const char* name;
+    double Metrics::* value;
+};
+
+const MetricField METRIC_FIELDS[] = {
+    {"EN", &Metrics::EN}, {"SF", &Metrics::SF}, {"AG", &Metrics::AG}, {"SD", &Metrics::SD},
+    {"EIN", &Metrics::EIN}, {"SSIM_IR", &Metrics::SSIM_IR}, {"SSIM_TV", &Metrics::SSIM_TV},
+};
+
+struct SyncCounterField {
+    const char* name;
+    uint64_t SyncCounters::* value;
+};
+
+const SyncCounterField SYNC_COUNTER_FIELDS[] = {
+    {"pairs", &SyncCounters::pairs}, {"irOverflow", &SyncCounters::irOverflow},
+    {"tvOverflow", &SyncCounters::tvOverflow}, {"irStale", &SyncCounters::irStale},
+    {"tvStale", &SyncCounters::tvStale},
+};
+
+const int SYNC_IR_HZ = 30, SYNC_TV_HZ = 25;
+const int64_t SECOND_NS = 1000000000;
+
+double median(std::vector<double> values)
+{
+    if (values.empty())
+        return 0;
+    const size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    return values[mid];
+}
+
+std::string format(const char* fmt, ...)
+{
+    char buffer[512];
+    va_list args;
+    va_start(args, fmt);
+    std::vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    return buffer;
+}
+
+// Counts buffers taken from the default allocators; everything else is
+// forwarded, and the UMatData/GpuMat keeps pointing at the real allocator.
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    explicit CountingMatAllocator(cv::MatAllocator* base) : base(base) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override
+    {
+        if (!data)
+            ++count;
+        return base->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+    bool allocate(cv::UMatData* u, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override
+    {
+        return base->allocate(u, accessFlags, usageFlags);
+    }
+    void deallocate(cv::UMatData* u) const override { base->deallocate(u); }
+
+    cv::MatAllocator* base;
+    mutable std::atomic<size_t> count{0};
+};
+
+class CountingGpuAllocator : public cv::cuda::GpuMat::Allocator {
+public:
+    explicit CountingGpuAllocator(cv::cuda::GpuMat::Allocator* base) : base(base) {}
+
+    bool allocate(cv::cuda::GpuMat* mat, int rows, int cols, size_t elemSize) override
+    {
+        ++count;
+        return base->allocate(mat, rows, cols, elemSize);
+    }
+    void free(cv::cuda::GpuMat* mat) override { base->free(mat); }
+
+    cv::cuda::GpuMat::Allocator* base;
+    std::atomic<size_t> count{0};
+};
+
+// Installs the counters for its lifetime. The allocators themselves are
+// never destroyed: buffers created through them may be freed much later.
+class AllocationHook {
+public:
+    AllocationHook()
+    {
+        static CountingMatAllocator host(cv::Mat::getStdAllocator());
+        static CountingGpuAllocator device(cv::cuda::GpuMat::defaultAllocator());
+        hostCounter = &host;
+        deviceCounter = &device;
+        previousHost = cv::Mat::getDefaultAllocator();
+        previousDevice = cv::cuda::GpuMat::defaultAllocator();
+        cv::Mat::setDefaultAllocator(&host);
+        cv::cuda::GpuMat::setDefaultAllocator(&device);
+    }
+    ~AllocationHook()
+    {
+        cv::Mat::setDefaultAllocator(previousHost);
+        cv::cuda::GpuMat::setDefaultAllocator(previousDevice);
+    }
+
+    size_t heapAllocations() const { return hostCounter->count + deviceCounter->count; }
+
+private:
+    CountingMatAllocator* hostCounter;
+    CountingGpuAllocator* deviceCounter;
+    cv::MatAllocator* previousHost;
+    cv::cuda::GpuMat::Allocator* previousDevice;
+};
+
+// Largest difference between the cells of blocks (step x step means of a
+// map, as SSIMResult::map and ::tiles hold them) and the same means of map.
+double maxBlockError(const cv::Mat& map, const cv::Mat& blocks, int step)
+{
+    cv::Mat means;
+    blocks.convertTo(means, CV_64F);
+    double error = 0;
+    for (int y = 0; y < means.rows; ++y)
+        for (int x = 0; x < means.cols; ++x) {
+            const cv::Rect cell = cv::Rect(x * step, y * step, step, step) & cv::Rect(0, 0, map.cols, map.rows);
+            error = std::max(error, std::fabs(cv::mean(map(cell))[0] - means.at<double>(y, x)));
+        }
+    return error;
+}
+
+// TV -> IR homography the registration check applies: a small rotation, scale
+// and shift about the centre plus a little perspective.
+cv::Matx33d knownWarp(cv::Size size)
+{
+    const double cx = size.width / 2.0, cy = size.height / 2.0;
+    const double angle = 2.0 * CV_PI / 180, scale = 1.03;
+    const double c = scale * std::cos(angle), s = scale * std::sin(angle);
+    const cv::Matx33d toCentre(1, 0, -cx, 0, 1, -cy, 0, 0, 1);
+    const cv::Matx33d fromCentre(1, 0, cx + 0.03 * size.width, 0, 1, cy - 0.02 * size.height, 0, 0, 1);
+    const cv::Matx33d similarity(c, -s, 0, s, c, 0, 0.02 / size.width, 0, 1);
+    return fromCentre * similarity * toCentre;
+}
+
+size_t arenaAllocations()
+{
+    const FrameArena::Stats stats = FrameArena::local().stats();
+    return stats.hostAllocations + stats.deviceAllocations;
+}
+
+} // namespace
+
+std::vector<RegressionCase> RegressionRunner::syntheticDataset(int count, cv::Size size, unsigned seed)
+{
+    std::vector<RegressionCase> dataset;
+    for (int i = 0; i < count; ++i) {
+        // Half a second apart, so the target visits different parts of the frame.
+        const double t = i * 0.5;
+        RegressionCase c;
+        c.name = format("synthetic_%03d", i);
+        c.tv = SyntheticScene::renderTV(size, t, seed);
+        c.ir = SyntheticScene::renderIR(size, t, seed);
+        dataset.push_back(c);
+    }
+    return dataset;
+}
+
+std::vector<RegressionCase> RegressionRunner::folderDataset(const std::string& dir)
+{
+    std::vector<cv::String> tvFiles;
+    cv::glob(dir + "/*_TV.*", tvFiles, true);
+    std::sort(tvFiles.begin(), tvFiles.end());
+
+    std::vector<RegressionCase> dataset;
+    for (const cv::String& tvFile : tvFiles) {
+        const size_t tag = tvFile.rfind("_TV.");
+        std::string irFile = tvFile;
+        irFile.replace(tag, 4, "_IR.");
+
+        RegressionCase c;
+        c.name = tvFile.substr(dir.size() + 1, tag - dir.size() - 1);
+        c.tv = cv::imread(tvFile, cv::IMREAD_GRAYSCALE);
+        c.ir = cv::imread(irFile, cv::IMREAD_GRAYSCALE);
+        if (c.tv.empty() || c.ir.empty())
+            continue;
+        if (c.ir.size() != c.tv.size())
+            cv::resize(c.ir, c.ir, c.tv.size(), 0, 0, cv::INTER_LINEAR);
+        dataset.push_back(c);
+    }
+    return dataset;
+}
+
+RegressionReport RegressionRunner::run(const std::vector<RegressionCase>& dataset,
+                                       const std::string& datasetId, int repeats)
+{
+    RegressionReport report;
+    report.dataset = datasetId;
+    repeats = std::max(1, repeats);
+    AllocationHook hook;
+
+    for (const Algorithm& alg : ALGORITHMS) {
+        AlgorithmResult result;
+        result.name = alg.name;
+        result.heapAllowance = alg.fuseBuffers + EVAL_BUFFERS;
+
+        // Reused across images, like a caller running at one resolution would.
+        cv::Mat fused, fusedGray;
+        auto toGray = [&fused, &fusedGray]() -> const cv::Mat& {
+            if (fused.channels() != 3)
+                return fused;
+            cv::cvtColor(fused, fusedGray, cv::COLOR_BGR2GRAY);
+            return fusedGray;
+        };
+
+        // Untimed warm-up: first use pays for filter creation and arena growth.
+        if (!dataset.empty())
+            alg.fuse(dataset[0].tv, dataset[0].ir, fused, FusionOptions());
+
+        std::vector<double> fuseTimes, metricsTimes, stageTimes[FusionTimings::StageCount];
+        for (const RegressionCase& c : dataset) {
+            ImageResult image;
+            image.image = c.name;
+            image.fuseMs = DBL_MAX;
+
+            FusionTimings timings;
+            FusionOptions options;
+            options.timings = &timings;
+            for (int r = 0; r < repeats; ++r) {
+                cv::TickMeter timer;
+                timer.start();
+                alg.fuse(c.tv, c.ir, fused, options);
+                timer.stop();
+                if (timer.getTimeMilli() < image.fuseMs) {
+                    image.fuseMs = timer.getTimeMilli();
+                    std::copy(timings.ms, timings.ms + FusionTimings::StageCount, image.stageMs);
+                }
+            }
+            const cv::Mat& gray = toGray();
+
+            cv::TickMeter timer;
+            timer.start();
+            image.metrics = QualityMetrics::eval(gray, c.ir, c.tv);
+            timer.stop();
+            image.metricsMs = timer.getTimeMilli();
+
+            fuseTimes.push_back(image.fuseMs);
+            metricsTimes.push_back(image.metricsMs);
+            for (int s = 0; s < FusionTimings::StageCount; ++s)
+                stageTimes[s].push_back(image.stageMs[s]);
+            result.images.push_back(image);
+        }
+        result.fuseMs = median(fuseTimes);
+        result.metricsMs = median(metricsTimes);
+        for (int s = 0; s < FusionTimings::StageCount; ++s)
+            result.stageMs[s] = median(stageTimes[s]);
+
+        // Steady state: one more fuse + eval of an already-seen case must be
+        // served from the arena and the reused outputs. On one thread, so that
+        // OpenCV's per-stripe buffers do not scale with the core count; the
+        // first round there warms the caller's thread-local workspaces.
+        if (!dataset.empty()) {
+            const RegressionCase& c = dataset[0];
+            const int threads = cv::getNumThreads();
+            cv::setNumThreads(1);
+            alg.fuse(c.tv, c.ir, fused, FusionOptions());
+            QualityMetrics::eval(toGray(), c.ir, c.tv);
+
+            const size_t arenaBefore = arenaAllocations();
+            const size_t heapBefore = hook.heapAllocations();
+            alg.fuse(c.tv, c.ir, fused, FusionOptions());
+            QualityMetrics::eval(toGray(), c.ir, c.tv);
+            result.heapAllocations = hook.heapAllocations() - heapBefore;
+            result.arenaGrowth = arenaAllocations() - arenaBefore;
+            cv::setNumThreads(threads);
+        }
+        report.algorithms.push_back(result);
+    }
+    return report;
+}
+
+void RegressionRunner::save(const RegressionReport& report, const std::string& path)
+{
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    CV_Assert(fs.isOpened());
+
+    fs << "dataset" << report.dataset;
+    fs << "algorithms" << "[";
+    for (const AlgorithmResult& alg : report.algorithms) {
+        fs << "{" << "name" << alg.name << "fuseMs" << alg.fuseMs << "metricsMs" << alg.metricsMs;
+        fs << "arenaGrowth" << static_cast<int>(alg.arenaGrowth)
+           << "heapAllocations" << static_cast<int>(alg.heapAllocations);
+        fs << "stageMs" << "{";
+        for (int s = 0; s < FusionTimings::StageCount; ++s)
+            fs << STAGE_NAMES[s] << alg.stageMs[s];
+        fs << "}";
+        fs << "images" << "[";
+        for (const ImageResult& image : alg.images) {
+            fs << "{" << "image" << image.image;
+            for (const MetricField& f : METRIC_FIELDS)
+                fs << f.name << image.metrics.*f.value;
+            fs << "fuseMs" << image.fuseMs << "metricsMs" << image.metricsMs;
+            fs << "stageMs" << "{";
+            for (int s = 0; s < FusionTimings::StageCount; ++s)
+                fs << STAGE_NAMES[s] << image.stageMs[s];
+            fs << "}" << "}";
+        }
+        fs << "]" << "}";
+    }
+    fs << "]";
+}
+
+bool RegressionRunner::load(const std::string& path, RegressionReport& report)
+{
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened())
+        return false;
+
+    report = RegressionReport();
+    fs["dataset"] >> report.dataset;
+    for (const cv::FileNode& algNode : fs["algorithms"]) {
+        AlgorithmResult alg;
+        algNode["name"] >> alg.name;
+        algNode["fuseMs"] >> alg.fuseMs;
+        algNode["metricsMs"] >> alg.metricsMs;
+        alg.arenaGrowth = static_cast<size_t>(static_cast<int>(algNode["arenaGrowth"]));
+        alg.heapAllocations = static_cast<size_t>(static_cast<int>(algNode["heapAllocations"]));
+        for (int s = 0; s < FusionTimings::StageCount; ++s)
+            algNode["stageMs"][STAGE_NAMES[s]] >> alg.stageMs[s];
+        for (const cv::FileNode& imageNode : algNode["images"]) {
+            ImageResult image;
+            imageNode["image"] >> image.image;
+            for (const MetricField& f : METRIC_FIELDS)
+                imageNode[f.name] >> image.metrics.*f.value;
+            imageNode["fuseMs"] >> image.fuseMs;
+            imageNode["metricsMs"] >> image.metricsMs;
+            for (int s = 0; s < FusionTimings::StageCount; ++s)
+                imageNode["stageMs"][STAGE_NAMES[s]] >> image.stageMs[s];
+            alg.images.push_back(image);
+        }
+        report.algorithms.push_back(alg);
+    }
+    return true;
+}
+
+std::vector<std::string> RegressionRunner::checkSSIM(const std::vector<RegressionCase>& dataset,
+                                                     const RegressionTolerances& tolerances)
+{
+    std::vector<std::string> failures;
+    const SSIMParams exactParams;
+    SSIMParams fastParams;
+    fastParams.mode = SSIMMode::Fast;
+
+    SSIMResult exact, fast;
+    cv::Mat referenceMap;
+    for (const RegressionCase& c : dataset) {
+        const double reference = SSIMReference::compute(c.tv, c.ir, referenceMap);
+        SSIMEngine::compute(c.tv, c.ir, exact, exactParams);
+        SSIMEngine::compute(c.tv, c.ir, fast, fastParams);
+
+        if (!(std::fabs(exact.mssim - reference) <= tolerances.ssimExact))
+            failures.push_back(format("SSIM/%s: exact mssim %.6f, reference %.6f",
+                                      c.name.c_str(), exact.mssim, reference));
+        const double mapError = maxBlockError(referenceMap, exact.map, exactParams.mapStep);
+        if (!(mapError <= tolerances.ssimExact))
+            failures.push_back(format("SSIM/%s: exact map is off the reference by %.6f",
+                                      c.name.c_str(), mapError));
+        const double tileError = maxBlockError(referenceMap, exact.tiles, exactParams.tileSize);
+        if (!(tileError <= tolerances.ssimExact))
+            failures.push_back(format("SSIM/%s: exact tiles are off the reference by %.6f",
+                                      c.name.c_str(), tileError));
+        if (!(std::fabs(fast.mssim - exact.mssim) <= tolerances.ssimFast))
+            failures.push_back(format("SSIM/%s: fast mssim %.6f, exact %.6f",
+                                      c.name.c_str(), fast.mssim, exact.mssim));
+    }
+    return failures;
+}
+
+std::vector<std::string> RegressionRunner::checkSync()
+{
+    std::vector<std::string> failures;
+    // Well ahead of the clock, so the age horizon never applies and the
+    // outcome depends on the timestamps alone.
+    const int64_t baseNs = steadyNowNs() + 60 * SECOND_NS;
+    auto captureNs = [baseNs](int index, int rateHz) { return baseNs + index * SECOND_NS / rateHz; };
+    auto frame = [&](int index, int rateHz) {
+        TimestampedFrame f;
+        f.captureNs = captureNs(index, rateHz);
+        f.sequence = static_cast<uint64_t>(index);
+        return f;
+    };
+    auto check = [&](const char* scenario, const FrameSynchronizer& sync,
+                     const std::vector<FramePair>& pairs,
+                     const std::vector<std::array<uint64_t, 2>>& expectedPairs,
+                     const SyncCounters& expected) {
+        if (pairs.size() != expectedPairs.size())
+            failures.push_back(format("sync/%s: %zu pairs, expected %zu",
+                                      scenario, pairs.size(), expectedPairs.size()));
+        for (size_t i = 0; i < std::min(pairs.size(), expectedPairs.size()); ++i)
+            if (pairs[i].ir.sequence != expectedPairs[i][0] || pairs[i].tv.sequence != expectedPairs[i][1]) {
+                failures.push_back(format("sync/%s: pair %zu is IR %llu + TV %llu, expected IR %llu + TV %llu",
+                                          scenario, i,
+                                          static_cast<unsigned long long>(pairs[i].ir.sequence),
+                                          static_cast<unsigned long long>(pairs[i].tv.sequence),
+                                          static_cast<unsigned long long>(expectedPairs[i][0]),
+                                          static_cast<unsigned long long>(expectedPairs[i][1])));
+                break;
+            }
+        const SyncCounters counters = sync.counters();
+        for (const SyncCounterField& f : SYNC_COUNTER_FIELDS)
+            if (counters.*f.value != expected.*f.value)
+                failures.push_back(format("sync/%s: %s %llu, expected %llu", scenario, f.name,
+                                          static_cast<unsigned long long>(counters.*f.value),
+                                          static_cast<unsigned long long>(expected.*f.value)));
+    };
+
+    // One second of frames pushed in capture order (IR first on ties) with
+    // the consumer polling after every push: each TV frame pairs with the
+    // nearest IR frame and the five IR frames that fall between are dropped.
+    {
+        FrameSynchronizer sync;
+        std::vector<FramePair> pairs;
+        FramePair pair;
+        for (int ir = 0, tv = 0; ir < SYNC_IR_HZ || tv < SYNC_TV_HZ;) {
+            if (tv == SYNC_TV_HZ || (ir < SYNC_IR_HZ && captureNs(ir, SYNC_IR_HZ) <= captureNs(tv, SYNC_TV_HZ)))
+                sync.pushIR(frame(ir++, SYNC_IR_HZ));
+            else
+                sync.pushTV(frame(tv++, SYNC_TV_HZ));
+            while (sync.nextPair(pair))
+                pairs.push_back(pair);
+        }
+        SyncCounters expected;
+        expected.pairs = 25;
+        expected.irStale = 5;
+        check("steady", sync, pairs,
+              {{0, 0}, {1, 1}, {2, 2}, {4, 3}, {5, 4}, {6, 5}, {7, 6}, {8, 7}, {10, 8}, {11, 9},
+               {12, 10}, {13, 11}, {14, 12}, {16, 13}, {17, 14}, {18, 15}, {19, 16}, {20, 17},
+               {22, 18}, {23, 19}, {24, 20}, {25, 21}, {26, 22}, {28, 23}, {29, 24}},
+              expected);
+    }
+
+    // The same second with the consumer stalled: each ring keeps its first
+    // eight frames and rejects the rest, then one poll drops all but the
+    // pair at the newest time both streams reached.
+    {
+        FrameSynchronizer sync;
+        for (int ir = 0; ir < SYNC_IR_HZ; ++ir)
+            sync.pushIR(frame(ir, SYNC_IR_HZ));
+        for (int tv = 0; tv < SYNC_TV_HZ; ++tv)
+            sync.pushTV(frame(tv, SYNC_TV_HZ));
+        std::vector<FramePair> pairs;
+        FramePair pair;
+        while (sync.nextPair(pair))
+            pairs.push_back(pair);
+        SyncCounters expected;
+        expected.pairs = 1;
+        expected.irOverflow = 22;
+        expected.tvOverflow = 17;
+        expected.irStale = 7;
+        expected.tvStale = 6;
+        check("stalled", sync, pairs, {{7, 6}}, expected);
+    }
+    return failures;
+}
+
+std::vector<std::string> RegressionRunner::checkRegistration(const std::vector<RegressionCase>& dataset,
+                                                             const RegressionTolerances& tolerances)
+{
+    std::vector<std::string> failures;
+    cv::Mat irWarped, fused;
+    for (const RegressionCase& c : dataset) {
+        const cv::Matx33d G = knownWarp(c.tv.size());
+        cv::warpPerspective(c.ir, irWarped, G, c.tv.size());
+
+        ImageRegistration registration;
+        FusionTimings cold, warm;
+        FusionOptions options;
+        options.registration = &registration;
+        options.timings = &cold;
+        ImageFusion::fuseImagesEPTDAC(c.tv, irWarped, {}, {}, fused, options);
+        options.timings = &warm;
+        ImageFusion::fuseImagesEPTDAC(c.tv, irWarped, {}, {}, fused, options);
+
+        // Same frame again, so this is the warm start's estimate unchanged.
+        const cv::Matx33d H(registration.estimate(c.tv, irWarped));
+        double error = 0;
+        const cv::Point2d corners[] = {{0, 0}, {c.tv.cols - 1.0, 0}, {0, c.tv.rows - 1.0},
+                                       {c.tv.cols - 1.0, c.tv.rows - 1.0}};
+        for (const cv::Point2d& p : corners) {
+            const cv::Vec3d q = H * (G * cv::Vec3d(p.x, p.y, 1));
+            error = std::max(error, std::hypot(q[0] / q[2] - p.x, q[1] / q[2] - p.y));
+        }
+        if (!(error <= tolerances.registrationPx))
+            failures.push_back(format("registration/%s: corner error %.3f px (correlation %.3f)",
+                                      c.name.c_str(), error, registration.correlation()));
+
+        const double coldMs = cold.ms[FusionTimings::Align], warmMs = warm.ms[FusionTimings::Align];
+        if (!(warmMs <= coldMs * tolerances.registrationWarm))
+            failures.push_back(format("registration/%s: warm align %.3f ms, cold %.3f ms",
+                                      c.name.c_str(), warmMs, coldMs));
+    }
+    return failures;
+}
+
+std::vector<std::string> RegressionRunner::compare(const RegressionReport& baseline,
+                                                   const RegressionReport& current,
+                                                   const RegressionTolerances& tolerances)
+{
+    std::vector<std::string> failures;
+    if (baseline.dataset != current.dataset) {
+        failures.push_back("dataset differs: baseline '" + baseline.dataset
+                           + "', current '" + current.dataset + "'");
+        return failures;
+    }
+
+    for (const AlgorithmResult& base : baseline.algorithms) {
+        auto it = std::find_if(current.algorithms.begin(), current.algorithms.end(),
+                               [&base](const AlgorithmResult& a) { return a.name == base.name; });
+        if (it == current.algorithms.end()) {
+            failures.push_back(base.name + ": missing from current run");
+            continue;
+        }
+        const AlgorithmResult& cur = *it;
+
+        if (cur.images.size() != base.images.size()) {
+            failures.push_back(format("%s: %zu images, baseline has %zu",
+                                      base.name.c_str(), cur.images.size(), base.images.size()));
+            continue;
+        }
+        for (size_t i = 0; i < base.images.size(); ++i) {
+            const ImageResult& b = base.images[i];
+            const ImageResult& c = cur.images[i];
+            if (b.image != c.image) {
+                failures.push_back(base.name + ": image '" + c.image + "' where baseline has '" + b.image + "'");
+                continue;
+            }
+            for (const MetricField& f : METRIC_FIELDS) {
+                const double expected = b.metrics.*f.value, actual = c.metrics.*f.value;
+                const double allowed = tolerances.absQuality + tolerances.relQuality * std::fabs(expected);
+                if (!(std::fabs(actual - expected) <= allowed))
+                    failures.push_back(format("%s/%s: %s drifted %.6g -> %.6g (allowed +/-%.3g)",
+                                              base.name.c_str(), b.image.c_str(), f.name,
+                                              expected, actual, allowed));
+            }
+        }
+
+        if (cur.arenaGrowth > 0)
+            failures.push_back(format("%s: arena grew by %zu block(s) in steady state",
+                                      base.name.c_str(), cur.arenaGrowth));
+        if (cur.heapAllocations > cur.heapAllowance)
+            failures.push_back(format("%s: %zu default-allocator buffers per call, OpenCV itself accounts for %zu",
+                                      base.name.c_str(), cur.heapAllocations, cur.heapAllowance));
+
+        auto slower = [&tolerances](double before, double after) {
+            return after > before * (1.0 + tolerances.timing) && after - before > tolerances.timingFloorMs;
+        };
+        if (slower(base.fuseMs, cur.fuseMs))
+            failures.push_back(format("%s: fusion slowed %.3f ms -> %.3f ms (+%.1f%%)",
+                                      base.name.c_str(), base.fuseMs, cur.fuseMs,
+                                      100.0 * (cur.fuseMs / base.fuseMs - 1.0)));
+        if (slower(base.metricsMs, cur.metricsMs))
+            failures.push_back(format("%s: metrics slowed %.3f ms -> %.3f ms (+%.1f%%)",
+                                      base.name.c_str(), base.metricsMs, cur.metricsMs,
+                                      100.0 * (cur.metricsMs / base.metricsMs - 1.0)));
+        // Stages a baseline did not record (non-EPTDAC algorithms) read as 0.
+        for (int s = 0; s < FusionTimings::StageCount; ++s)
+            if (base.stageMs[s] > 0 && slower(base.stageMs[s], cur.stageMs[s]))
+                failures.push_back(format("%s: %s stage slowed %.3f ms -> %.3f ms (+%.1f%%)",
+                                          base.name.c_str(), STAGE_NAMES[s], base.stageMs[s], cur.stageMs[s],
+                                          100.0 * (cur.stageMs[s] / base.stageMs[s] - 1.0)));
+    }
+
+    // An algorithm the baseline has never seen is not gated at all, so it
+    // fails until the baseline is regenerated.
+    for (const AlgorithmResult& cur : current.algorithms) {
+        const bool known = std::any_of(baseline.algorithms.begin(), baseline.algorithms.end(),
+                                       [&cur](const AlgorithmResult& a) { return a.name == cur.name; });
+        if (!known)
+            failures.push_back(cur.name + ": not in baseline; regenerate it with --update-baseline");
+    }
+    return failures;
+}
@@ -0,0 +1,236 @@
+#include "regressionrunner.h"
+#include "syntheticscene.h"
+#include "framearena.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace {
+
+const int EXIT_PASS = 0;
+const int EXIT_REGRESSION = 1;
+const int EXIT_USAGE = 2;
+
+const double LIVE_IR_HZ = 30;
+const double LIVE_TV_HZ = 25;
+
+void printUsage()
+{
+    std::printf(
+        "usage: eptdac_regress [options]\n"
+        "  --baseline FILE      baseline to compare against (default eptdac_baseline.yml)\n"
+        "  --update-baseline    write the current results as the new baseline\n"
+        "  --dataset DIR        pairs <name>_TV.* / <name>_IR.* under DIR (default: synthetic)\n"
+        "  --count N            synthetic pairs (default 8)\n"
+        "  --size WxH           synthetic frame size (default 640x480)\n"
+        "  --seed N             synthetic scene seed (default 0)\n"
+        "  --repeats N          timed runs per image, best is kept (default 3)\n"
+        "  --abs-tol X          absolute metric tolerance (default 1e-3)\n"
+        "  --rel-tol X          relative metric tolerance (default 0.01)\n"
+        "  --time-tol X         allowed stage slowdown, 0.15 = 15%% (default 0.15)\n"
+        "  --time-floor MS      ignore slowdowns below MS milliseconds (default 0.1)\n"
+        "  --ssim-fast-tol X    allowed fast - exact SSIM difference (default 0.05)\n"
+        "  --report FILE        also write the current results to FILE\n"
+        "  --live SECONDS       instead, run synthetic %g Hz IR / %g Hz TV feeds through\n"
+        "                       LivePipeline and report latency and dropped frames\n"
+        "  --max-p99-ms MS      with --live, fail when the p99 latency exceeds MS\n",
+        LIVE_IR_HZ, LIVE_TV_HZ);
+}
+
+void printReport(const RegressionReport& report)
+{
+    std::printf("dataset: %s\n", report.dataset.c_str());
+    std::printf("%-16s %10s %10s %8s %8s %8s %8s %8s %8s %6s %6s %6s\n",
+                "algorithm", "fuse ms", "eval ms", "EN", "SF", "AG", "SD", "EIN", "SSIM", "heap", "allow", "arena");
+    for (const AlgorithmResult& alg : report.algorithms) {
+        Metrics avg;
+        double ssim = 0;
+        for (const ImageResult& image : alg.images) {
+            avg.EN += image.metrics.EN;
+            avg.SF += image.metrics.SF;
+            avg.AG += image.metrics.AG;
+            avg.SD += image.metrics.SD;
+            avg.EIN += image.metrics.EIN;
+            ssim += (image.metrics.SSIM_IR + image.metrics.SSIM_TV) / 2;
+        }
+        const double n = alg.images.empty() ? 1.0 : static_cast<double>(alg.images.size());
+        std::printf("%-16s %10.3f %10.3f %8.4f %8.3f %8.3f %8.3f %8.3f %8.4f %6zu %6zu %6zu\n",
+                    alg.name.c_str(), alg.fuseMs, alg.metricsMs,
+                    avg.EN / n, avg.SF / n, avg.AG / n, avg.SD / n, avg.EIN / n, ssim / n,
+                    alg.heapAllocations, alg.heapAllowance, alg.arenaGrowth);
+        const double* stage = alg.stageMs;
+        if (stage[FusionTimings::Align] + stage[FusionTimings::EdgeWeights] + stage[FusionTimings::Blend] > 0)
+            std::printf("%-16s stages ms: align %.3f, edge/weights %.3f, mask %.3f, blend %.3f\n", "",
+                        stage[FusionTimings::Align], stage[FusionTimings::EdgeWeights],
+                        stage[FusionTimings::Mask], stage[FusionTimings::Blend]);
+    }
+
+    FrameArena::Stats arena = FrameArena::local().stats();
+    std::printf("frame arena: host allocations=%zu reuses=%zu, device allocations=%zu reuses=%zu\n",
+                arena.hostAllocations, arena.hostReuses, arena.deviceAllocations, arena.deviceReuses);
+}
+
+int runLive(cv::Size size, unsigned seed, double seconds, double maxP99Ms)
+{
+    LivePipeline pipeline(std::make_unique<SyntheticSource>(size, true, seed), LIVE_IR_HZ,
+                          std::make_unique<SyntheticSource>(size, false, seed), LIVE_TV_HZ,
+                          LivePipeline::eptdacFusion(size), nullptr);
+    pipeline.start();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    pipeline.stop();
+
+    const PipelineStats stats = pipeline.stats();
+    std::printf("live: %.1f s at %dx%d, IR %g Hz, TV %g Hz\n",
+                seconds, size.width, size.height, LIVE_IR_HZ, LIVE_TV_HZ);
+    std::printf("fused %llu of %llu pairs\n", static_cast<unsigned long long>(stats.fused),
+                static_cast<unsigned long long>(stats.sync.pairs));
+    std::printf("latency ms: p50=%.2f p99=%.2f max=%.2f (%llu samples)\n",
+                stats.latency.p50Ms, stats.latency.p99Ms, stats.latency.maxMs,
+                static_cast<unsigned long long>(stats.latency.count));
+    std::printf("dropped: IR overflow=%llu stale=%llu, TV overflow=%llu stale=%llu\n",
+                static_cast<unsigned long long>(stats.sync.irOverflow),
+                static_cast<unsigned long long>(stats.sync.irStale),
+                static_cast<unsigned long long>(stats.sync.tvOverflow),
+                static_cast<unsigned long long>(stats.sync.tvStale));
+
+    if (stats.fused == 0) {
+        std::printf("FAIL no pairs fused\n");
+        return EXIT_REGRESSION;
+    }
+    if (maxP99Ms > 0 && stats.latency.p99Ms > maxP99Ms) {
+        std::printf("FAIL p99 latency %.2f ms exceeds %.2f ms\n", stats.latency.p99Ms, maxP99Ms);
+        return EXIT_REGRESSION;
+    }
+    std::printf("PASS\n");
+    return EXIT_PASS;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string baselinePath = "eptdac_baseline.yml", datasetDir, reportPath;
+    bool updateBaseline = false;
+    int count = 8, repeats = 3;
+    double liveSeconds = 0, maxP99Ms = 0;
+    unsigned seed = 0;
+    cv::Size size(640, 480);
+    RegressionTolerances tolerances;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto needsValue = [&]() {
+            if (!value) {
+                std::fprintf(stderr, "%s needs a value\n", arg);
+                std::exit(EXIT_USAGE);
+            }
+            ++i;
+            return value;
+        };
+
+        if (!std::strcmp(arg, "--baseline"))             baselinePath = needsValue();
+        else if (!std::strcmp(arg, "--update-baseline")) updateBaseline = true;
+        else if (!std::strcmp(arg, "--dataset"))         datasetDir = needsValue();
+        else if (!std::strcmp(arg, "--count"))           count = std::atoi(needsValue());
+        else if (!std::strcmp(arg, "--seed"))            seed = static_cast<unsigned>(std::strtoul(needsValue(), nullptr, 10));
+        else if (!std::strcmp(arg, "--repeats"))         repeats = std::atoi(needsValue());
+        else if (!std::strcmp(arg, "--abs-tol"))         tolerances.absQuality = std::atof(needsValue());
+        else if (!std::strcmp(arg, "--rel-tol"))         tolerances.relQuality = std::atof(needsValue());
+        else if (!std::strcmp(arg, "--time-tol"))        tolerances.timing = std::atof(needsValue());
+        else if (!std::strcmp(arg, "--time-floor"))      tolerances.timingFloorMs = std::atof(needsValue());
+        else if (!std::strcmp(arg, "--ssim-fast-tol"))   tolerances.ssimFast = std::atof(needsValue());
+        else if (!std::strcmp(arg, "--report"))          reportPath = needsValue();
+        else if (!std::strcmp(arg, "--live"))            liveSeconds = std::atof(needsValue());
+        else if (!std::strcmp(arg, "--max-p99-ms"))      maxP99Ms = std::atof(needsValue());
+        else if (!std::strcmp(arg, "--size")) {
+            if (std::sscanf(needsValue(), "%dx%d", &size.width, &size.height) != 2) {
+                std::fprintf(stderr, "--size expects WxH\n");
+                return EXIT_USAGE;
+            }
+        } else {
+            printUsage();
+            return EXIT_USAGE;
+        }
+    }
+    if (count <= 0 || size.width < 2 || size.height < 2) {
+        std::fprintf(stderr, "invalid synthetic dataset parameters\n");
+        return EXIT_USAGE;
+    }
+    if (liveSeconds > 0)
+        return runLive(size, seed, liveSeconds, maxP99Ms);
+
+    std::vector<RegressionCase> dataset;
+    std::string datasetId;
+    if (datasetDir.empty()) {
+        dataset = RegressionRunner::syntheticDataset(count, size, seed);
+        datasetId = "synthetic:" + std::to_string(count) + ":" + std::to_string(size.width)
+                  + "x" + std::to_string(size.height) + ":" + std::to_string(seed);
+    } else {
+        dataset = RegressionRunner::folderDataset(datasetDir);
+        datasetId = "folder:" + datasetDir;
+    }
+    if (dataset.empty()) {
+        std::fprintf(stderr, "dataset is empty\n");
+        return EXIT_USAGE;
+    }
+
+    const std::vector<std::string> syncFailures = RegressionRunner::checkSync();
+    for (const std::string& failure : syncFailures)
+        std::printf("FAIL %s\n", failure.c_str());
+    if (!syncFailures.empty()) {
+        std::printf("FAIL: frame synchronizer check failed\n");
+        return EXIT_REGRESSION;
+    }
+
+    // The metrics below are only as good as the SSIM engine, so a baseline
+    // is never written from a run where it disagrees with the reference.
+    const std::vector<std::string> ssimFailures = RegressionRunner::checkSSIM(dataset, tolerances);
+    for (const std::string& failure : ssimFailures)
+        std::printf("FAIL %s\n", failure.c_str());
+    if (!ssimFailures.empty()) {
+        std::printf("FAIL: SSIM engine check failed on %zu case(s)\n", ssimFailures.size());
+        return EXIT_REGRESSION;
+    }
+
+    // Folder pairs are not known to be registered, so only synthetic ones
+    // can tell whether the recovered homography is right.
+    if (datasetDir.empty()) {
+        const std::vector<std::string> registrationFailures = RegressionRunner::checkRegistration(dataset, tolerances);
+        for (const std::string& failure : registrationFailures)
+            std::printf("FAIL %s\n", failure.c_str());
+        if (!registrationFailures.empty()) {
+            std::printf("FAIL: registration check failed on %zu case(s)\n", registrationFailures.size());
+            return EXIT_REGRESSION;
+        }
+    }
+
+    RegressionReport current = RegressionRunner::run(dataset, datasetId, repeats);
+    printReport(current);
+    if (!reportPath.empty())
+        RegressionRunner::save(current, reportPath);
+
+    if (updateBaseline) {
+        RegressionRunner::save(current, baselinePath);
+        std::printf("baseline written to %s\n", baselinePath.c_str());
+        return EXIT_PASS;
+    }
+
+    RegressionReport baseline;
+    if (!RegressionRunner::load(baselinePath, baseline)) {
+        std::fprintf(stderr, "cannot read baseline %s (create it with --update-baseline)\n",
+                     baselinePath.c_str());
+        return EXIT_USAGE;
+    }
+
+    const std::vector<std::string> failures = RegressionRunner::compare(baseline, current, tolerances);
+    for (const std::string& failure : failures)
+        std::printf("FAIL %s\n", failure.c_str());
+    std::printf("%s: %zu regression(s) against %s\n", failures.empty() ? "PASS" : "FAIL",
+                failures.size(), baselinePath.c_str());
+    return failures.empty() ? EXIT_PASS : EXIT_REGRESSION;
+}
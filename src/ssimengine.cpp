@@ -0,0 +1,331 @@
+#include "ssimengine.h"
+#include "framearena.h"
+#include "fusionkernels.h"
+
+#include <opencv2/core/utility.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace {
+
+const double C1 = 6.5025, C2 = 58.5225;
+const int GAUSS_SIZE = 11;
+constexpr std::array<float, GAUSS_SIZE> GAUSS_WINDOW = makeGaussianKernel<GAUSS_SIZE>(1.5);
+
+template <typename T>
+inline T ssimValue(T mu1, T mu2, T xx, T yy, T xy)
+{
+    const T mu1_sq = mu1 * mu1, mu2_sq = mu2 * mu2, mu1_mu2 = mu1 * mu2;
+    const T sigma1_sq = xx - mu1_sq, sigma2_sq = yy - mu2_sq, sigma12 = xy - mu1_mu2;
+    return ((2 * mu1_mu2 + T(C1)) * (2 * sigma12 + T(C2))) /
+           ((mu1_sq + mu2_sq + T(C1)) * (sigma1_sq + sigma2_sq + T(C2)));
+}
+
+cv::Mat prepareInput(const cv::Mat& img)
+{
+    cv::Mat gray = img;
+    if (gray.channels() > 1) {
+        gray = FrameArena::local().mat();
+        cv::extractChannel(img, gray, 0);
+    }
+    if (gray.depth() != CV_8U && gray.depth() != CV_32F) {
+        cv::Mat gray_f = FrameArena::local().mat();
+        gray.convertTo(gray_f, CV_32F);
+        return gray_f;
+    }
+    return gray;
+}
+
+void loadRow(const cv::Mat& src, int y, const int* xIdx, int n, float* dst)
+{
+    if (src.depth() == CV_8U) {
+        const uchar* p = src.ptr<uchar>(y);
+        for (int k = 0; k < n; ++k)
+            dst[k] = p[xIdx[k]];
+    } else {
+        const float* p = src.ptr<float>(y);
+        for (int k = 0; k < n; ++k)
+            dst[k] = p[xIdx[k]];
+    }
+}
+
+// Gaussian-weighted sums of the five statistics planes for tw outputs:
+// dst[j] = sum_k g[k] * src[j + k * step]. step is 1 for the horizontal pass
+// and the plane width for the vertical one.
+template <int KSize>
+inline void gaussRow(const std::array<float, KSize>& g, const float* const* src, int step, int tw,
+                     float* const* dst)
+{
+    int j = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    for (; j <= tw - lanes; j += lanes) {
+        cv::v_float32 s0 = cv::vx_setzero_f32(), s1 = cv::vx_setzero_f32(), s2 = cv::vx_setzero_f32(),
+                      s3 = cv::vx_setzero_f32(), s4 = cv::vx_setzero_f32();
+        for (int k = 0; k < KSize; ++k) {
+            const cv::v_float32 w = cv::vx_setall_f32(g[k]);
+            const int off = j + k * step;
+            s0 = cv::v_fma(w, cv::vx_load(src[0] + off), s0);
+            s1 = cv::v_fma(w, cv::vx_load(src[1] + off), s1);
+            s2 = cv::v_fma(w, cv::vx_load(src[2] + off), s2);
+            s3 = cv::v_fma(w, cv::vx_load(src[3] + off), s3);
+            s4 = cv::v_fma(w, cv::vx_load(src[4] + off), s4);
+        }
+        cv::v_store(dst[0] + j, s0);
+        cv::v_store(dst[1] + j, s1);
+        cv::v_store(dst[2] + j, s2);
+        cv::v_store(dst[3] + j, s3);
+        cv::v_store(dst[4] + j, s4);
+    }
+#endif
+    for (; j < tw; ++j)
+        for (int q = 0; q < 5; ++q) {
+            float sum = 0;
+            for (int k = 0; k < KSize; ++k)
+                sum += g[k] * src[q][j + k * step];
+            dst[q][j] = sum;
+        }
+}
+
+// x, y -> x, y, x^2, y^2, xy
+inline void products(float* const* p, int n)
+{
+    int k = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    for (; k <= n - lanes; k += lanes) {
+        const cv::v_float32 x = cv::vx_load(p[0] + k), y = cv::vx_load(p[1] + k);
+        cv::v_store(p[2] + k, cv::v_mul(x, x));
+        cv::v_store(p[3] + k, cv::v_mul(y, y));
+        cv::v_store(p[4] + k, cv::v_mul(x, y));
+    }
+#endif
+    for (; k < n; ++k) {
+        p[2][k] = p[0][k] * p[0][k];
+        p[3][k] = p[1][k] * p[1][k];
+        p[4][k] = p[0][k] * p[1][k];
+    }
+}
+
+inline void ssimRow(const float* const* v, int n, float* out)
+{
+    int j = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+    const cv::v_float32 c1 = cv::vx_setall_f32(static_cast<float>(C1));
+    const cv::v_float32 c2 = cv::vx_setall_f32(static_cast<float>(C2));
+    const cv::v_float32 two = cv::vx_setall_f32(2.f);
+    for (; j <= n - lanes; j += lanes) {
+        const cv::v_float32 mu1 = cv::vx_load(v[0] + j), mu2 = cv::vx_load(v[1] + j);
+        const cv::v_float32 mu1_sq = cv::v_mul(mu1, mu1), mu2_sq = cv::v_mul(mu2, mu2);
+        const cv::v_float32 mu1_mu2 = cv::v_mul(mu1, mu2);
+        const cv::v_float32 sigma1_sq = cv::v_sub(cv::vx_load(v[2] + j), mu1_sq);
+        const cv::v_float32 sigma2_sq = cv::v_sub(cv::vx_load(v[3] + j), mu2_sq);
+        const cv::v_float32 sigma12 = cv::v_sub(cv::vx_load(v[4] + j), mu1_mu2);
+        const cv::v_float32 num = cv::v_mul(cv::v_fma(two, mu1_mu2, c1), cv::v_fma(two, sigma12, c2));
+        const cv::v_float32 den = cv::v_mul(cv::v_add(cv::v_add(mu1_sq, mu2_sq), c1),
+                                            cv::v_add(cv::v_add(sigma1_sq, sigma2_sq), c2));
+        cv::v_store(out + j, cv::v_div(num, den));
+    }
+#endif
+    for (; j < n; ++j)
+        out[j] = ssimValue(v[0][j], v[1][j], v[2][j], v[3][j], v[4][j]);
+}
+
+// Separable Gaussian statistics of one tile: the horizontal pass runs over the
+// tile plus a reflected halo, the vertical pass writes SSIM straight into ssim.
+template <int KSize>
+void exactTile(const cv::Mat& a, const cv::Mat& b, const cv::Rect& tile,
+               const std::array<float, KSize>& g, float* ssim)
+{
+    const int r = KSize / 2;
+    const int tw = tile.width, th = tile.height;
+    const int pw = tw + 2 * r, ph = th + 2 * r;
+
+    thread_local std::vector<int> xIdx;
+    thread_local std::vector<float> rows, horiz, vert;
+    xIdx.resize(pw);
+    rows.resize(5 * pw);
+    horiz.resize(5 * ph * tw);
+    vert.resize(5 * tw);
+
+    for (int k = 0; k < pw; ++k)
+        xIdx[k] = cv::borderInterpolate(tile.x - r + k, a.cols, cv::BORDER_REFLECT_101);
+
+    float* const row[5] = {rows.data(), rows.data() + pw, rows.data() + 2 * pw,
+                           rows.data() + 3 * pw, rows.data() + 4 * pw};
+    const float* const rowIn[5] = {row[0], row[1], row[2], row[3], row[4]};
+    float* h[5];
+    for (int q = 0; q < 5; ++q)
+        h[q] = horiz.data() + q * ph * tw;
+
+    for (int i = 0; i < ph; ++i) {
+        const int y = cv::borderInterpolate(tile.y - r + i, a.rows, cv::BORDER_REFLECT_101);
+        loadRow(a, y, xIdx.data(), pw, row[0]);
+        loadRow(b, y, xIdx.data(), pw, row[1]);
+        products(row, pw);
+
+        float* const out[5] = {h[0] + i * tw, h[1] + i * tw, h[2] + i * tw, h[3] + i * tw, h[4] + i * tw};
+        gaussRow<KSize>(g, rowIn, 1, tw, out);
+    }
+
+    float* const v[5] = {vert.data(), vert.data() + tw, vert.data() + 2 * tw,
+                         vert.data() + 3 * tw, vert.data() + 4 * tw};
+    const float* const vIn[5] = {v[0], v[1], v[2], v[3], v[4]};
+    for (int i = 0; i < th; ++i) {
+        const float* const in[5] = {h[0] + i * tw, h[1] + i * tw, h[2] + i * tw, h[3] + i * tw, h[4] + i * tw};
+        gaussRow<KSize>(g, in, tw, tw, v);
+        ssimRow(vIn, tw, ssim + i * tw);
+    }
+}
+
+// Box-window statistics of one tile from a local five-channel integral image
+// of x, y, x^2, y^2 and xy; the window is clipped at the image border.
+void fastTile(const cv::Mat& a, const cv::Mat& b, const cv::Rect& tile, int r, float* ssim)
+{
+    const cv::Rect halo = cv::Rect(tile.x - r, tile.y - r, tile.width + 2 * r, tile.height + 2 * r)
+                          & cv::Rect(0, 0, a.cols, a.rows);
+    const int hw = halo.width, hh = halo.height;
+    const int stride = (hw + 1) * 5;
+
+    thread_local std::vector<int> xIdx;
+    thread_local std::vector<float> rowA, rowB;
+    thread_local std::vector<double> sums;
+    xIdx.resize(hw);
+    rowA.resize(hw);
+    rowB.resize(hw);
+    sums.resize((hh + 1) * stride);
+
+    for (int k = 0; k < hw; ++k)
+        xIdx[k] = halo.x + k;
+    std::fill(sums.begin(), sums.begin() + stride, 0.0);
+
+    for (int i = 0; i < hh; ++i) {
+        loadRow(a, halo.y + i, xIdx.data(), hw, rowA.data());
+        loadRow(b, halo.y + i, xIdx.data(), hw, rowB.data());
+        const double* prev = &sums[i * stride];
+        double* cur = &sums[(i + 1) * stride];
+        std::fill(cur, cur + 5, 0.0);
+
+        double s1 = 0, s2 = 0, s11 = 0, s22 = 0, s12 = 0;
+        for (int j = 0; j < hw; ++j) {
+            const double x = rowA[j], y = rowB[j];
+            s1 += x;
+            s2 += y;
+            s11 += x * x;
+            s22 += y * y;
+            s12 += x * y;
+            const double* p = prev + (j + 1) * 5;
+            double* c = cur + (j + 1) * 5;
+            c[0] = p[0] + s1;
+            c[1] = p[1] + s2;
+            c[2] = p[2] + s11;
+            c[3] = p[3] + s22;
+            c[4] = p[4] + s12;
+        }
+    }
+
+    for (int i = 0; i < tile.height; ++i) {
+        const int y = tile.y + i;
+        const int y0 = std::max(y - r, 0) - halo.y;
+        const int y1 = std::min(y + r + 1, a.rows) - halo.y;
+        float* out = ssim + i * tile.width;
+        for (int j = 0; j < tile.width; ++j) {
+            const int x = tile.x + j;
+            const int x0 = std::max(x - r, 0) - halo.x;
+            const int x1 = std::min(x + r + 1, a.cols) - halo.x;
+            const double inv = 1.0 / ((y1 - y0) * (x1 - x0));
+            const double* p00 = &sums[y0 * stride + x0 * 5];
+            const double* p01 = &sums[y0 * stride + x1 * 5];
+            const double* p10 = &sums[y1 * stride + x0 * 5];
+            const double* p11 = &sums[y1 * stride + x1 * 5];
+            double m[5];
+            for (int q = 0; q < 5; ++q)
+                m[q] = (p11[q] - p10[q] - p01[q] + p00[q]) * inv;
+            out[j] = static_cast<float>(ssimValue(m[0], m[1], m[2], m[3], m[4]));
+        }
+    }
+}
+
+double reduceTile(const float* ssim, const cv::Rect& tile, int mapStep, cv::Mat& map)
+{
+    double tileSum = 0;
+    for (int cy = 0; cy < tile.height; cy += mapStep) {
+        const int ch = std::min(mapStep, tile.height - cy);
+        for (int cx = 0; cx < tile.width; cx += mapStep) {
+            const int cw = std::min(mapStep, tile.width - cx);
+            double cellSum = 0;
+            for (int y = cy; y < cy + ch; ++y) {
+                const float* row = ssim + y * tile.width;
+                for (int x = cx; x < cx + cw; ++x)
+                    cellSum += row[x];
+            }
+            map.at<float>((tile.y + cy) / mapStep, (tile.x + cx) / mapStep) =
+                static_cast<float>(cellSum / (ch * cw));
+            tileSum += cellSum;
+        }
+    }
+    return tileSum;
+}
+
+} // namespace
+
+SSIMResult SSIMEngine::compute(const cv::Mat& img1, const cv::Mat& img2, const SSIMParams& params)
+{
+    SSIMResult result;
+    compute(img1, img2, result, params);
+    return result;
+}
+
+void SSIMEngine::compute(const cv::Mat& img1, const cv::Mat& img2, SSIMResult& result,
+                         const SSIMParams& params)
+{
+    CV_Assert(!img1.empty() && img1.size() == img2.size());
+    CV_Assert(params.mapStep > 0 && params.tileSize > 0 && params.tileSize % params.mapStep == 0);
+    CV_Assert(params.mode == SSIMMode::Exact || params.boxSize > 0);
+
+    const cv::Mat a = prepareInput(img1);
+    const cv::Mat b = prepareInput(img2);
+
+    const int rows = a.rows, cols = a.cols;
+    const int tileSize = params.tileSize, mapStep = params.mapStep;
+    const int tilesX = (cols + tileSize - 1) / tileSize;
+    const int tilesY = (rows + tileSize - 1) / tileSize;
+
+    result.map.create((rows + mapStep - 1) / mapStep, (cols + mapStep - 1) / mapStep, CV_32F);
+    result.tiles.create(tilesY, tilesX, CV_64F);
+    cv::Mat& tiles = result.tiles;
+    cv::Mat& map = result.map;
+
+    // Tiles first hold their SSIM sums, so the total adds up exactly as before
+    // and no separate sum buffer is needed.
+    cv::parallel_for_(cv::Range(0, tilesX * tilesY), [&](const cv::Range& range) {
+        thread_local std::vector<float> ssimTile;
+        for (int t = range.start; t < range.end; ++t) {
+            const int tx = t % tilesX, ty = t / tilesX;
+            const cv::Rect tile(tx * tileSize, ty * tileSize,
+                                std::min(tileSize, cols - tx * tileSize),
+                                std::min(tileSize, rows - ty * tileSize));
+            ssimTile.resize(tile.area());
+
+            if (params.mode == SSIMMode::Exact)
+                exactTile<GAUSS_SIZE>(a, b, tile, GAUSS_WINDOW, ssimTile.data());
+            else
+                fastTile(a, b, tile, params.boxSize / 2, ssimTile.data());
+
+            tiles.at<double>(ty, tx) = reduceTile(ssimTile.data(), tile, mapStep, map);
+        }
+    });
+
+    double total = 0;
+    for (int ty = 0; ty < tilesY; ++ty)
+        for (int tx = 0; tx < tilesX; ++tx) {
+            double& tile = tiles.at<double>(ty, tx);
+            total += tile;
+            tile /= std::min(tileSize, cols - tx * tileSize) * std::min(tileSize, rows - ty * tileSize);
+        }
+    result.mssim = total / (static_cast<double>(rows) * cols);
+}
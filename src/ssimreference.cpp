@@ -0,0 +1,40 @@
+#include "ssimreference.h"
+
+double SSIMReference::compute(const cv::Mat& img1, const cv::Mat& img2, cv::Mat& ssimMap)
+{
+    cv::Mat img1_f, img2_f;
+    img1.convertTo(img1_f, CV_32F);
+    img2.convertTo(img2_f, CV_32F);
+
+    cv::Mat mu1, mu2;
+    cv::GaussianBlur(img1_f, mu1, cv::Size(11, 11), 1.5);
+    cv::GaussianBlur(img2_f, mu2, cv::Size(11, 11), 1.5);
+
+    cv::Mat mu1_sq = mu1.mul(mu1);
+    cv::Mat mu2_sq = mu2.mul(mu2);
+    cv::Mat mu1_mu2 = mu1.mul(mu2);
+
+    cv::Mat sigma1_sq, sigma2_sq, sigma12;
+    cv::GaussianBlur(img1_f.mul(img1_f), sigma1_sq, cv::Size(11, 11), 1.5);
+    sigma1_sq -= mu1_sq;
+
+    cv::GaussianBlur(img2_f.mul(img2_f), sigma2_sq, cv::Size(11, 11), 1.5);
+    sigma2_sq -= mu2_sq;
+
+    cv::GaussianBlur(img1_f.mul(img2_f), sigma12, cv::Size(11, 11), 1.5);
+    sigma12 -= mu1_mu2;
+
+    const double C1 = 6.5025, C2 = 58.5225;
+    cv::Mat t1, t2, t3;
+
+    t1 = 2 * mu1_mu2 + C1;
+    t2 = 2 * sigma12 + C2;
+    t3 = t1.mul(t2);
+
+    t1 = mu1_sq + mu2_sq + C1;
+    t2 = sigma1_sq + sigma2_sq + C2;
+    t1 = t1.mul(t2);
+
+    cv::divide(t3, t1, ssimMap);
+    return cv::mean(ssimMap)[0];
+}
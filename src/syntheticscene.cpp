@@ -0,0 +1,95 @@
+#include "syntheticscene.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double TWO_PI = 6.283185307179586;
+
+}
+
+cv::Point2f SyntheticScene::targetAt(cv::Size size, double t, unsigned seed)
+{
+    const double phase = seed * 0.7;
+    const double x = 0.5 + 0.35 * std::sin(TWO_PI * 0.10 * t + phase);
+    const double y = 0.5 + 0.25 * std::sin(TWO_PI * 0.07 * t + 1.3 + phase);
+    return cv::Point2f(static_cast<float>(x * size.width), static_cast<float>(y * size.height));
+}
+
+void SyntheticScene::addNoise(cv::Mat& img, double sigma, double t, unsigned seed)
+{
+    cv::RNG rng(static_cast<uint64>(seed) * 7919u + static_cast<uint64>(std::llround(t * 1000.0)) + 1);
+    cv::Mat noise(img.size(), CV_32F);
+    rng.fill(noise, cv::RNG::NORMAL, 0.0, sigma);
+    img += noise;
+}
+
+cv::Mat SyntheticScene::renderTV(cv::Size size, double t, unsigned seed)
+{
+    cv::Mat img(size, CV_32F);
+    for (int y = 0; y < size.height; ++y) {
+        float* row = img.ptr<float>(y);
+        for (int x = 0; x < size.width; ++x)
+            row[x] = 70.f + 90.f * x / size.width + 40.f * y / size.height
+                   + 15.f * std::sin(x * 0.21f) * std::sin(y * 0.17f);
+    }
+
+    // Static structures so registration and the gradient-based metrics have edges to work with.
+    cv::RNG layout(seed + 17);
+    for (int i = 0; i < 6; ++i) {
+        const int w = layout.uniform(size.width / 12, size.width / 5);
+        const int h = layout.uniform(size.height / 10, size.height / 3);
+        const int x = layout.uniform(0, std::max(1, size.width - w));
+        const int y = layout.uniform(0, std::max(1, size.height - h));
+        cv::rectangle(img, cv::Rect(x, y, w, h), cv::Scalar(layout.uniform(30.0, 220.0)), cv::FILLED);
+    }
+
+    const cv::Point2f target = targetAt(size, t, seed);
+    const int r = std::max(2, std::min(size.width, size.height) / 12);
+    cv::rectangle(img, cv::Rect(cvRound(target.x) - r, cvRound(target.y) - r / 2, 2 * r, r),
+                  cv::Scalar(35), cv::FILLED);
+
+    addNoise(img, 4.0, t, seed);
+    cv::Mat result;
+    img.convertTo(result, CV_8U);
+    return result;
+}
+
+cv::Mat SyntheticScene::renderIR(cv::Size size, double t, unsigned seed)
+{
+    cv::Mat img(size, CV_32F);
+    for (int y = 0; y < size.height; ++y)
+        img.row(y).setTo(cv::Scalar(45.0 + 25.0 * y / size.height));
+
+    cv::RNG layout(seed + 17);
+    for (int i = 0; i < 6; ++i) {
+        const int w = layout.uniform(size.width / 12, size.width / 5);
+        const int h = layout.uniform(size.height / 10, size.height / 3);
+        const int x = layout.uniform(0, std::max(1, size.width - w));
+        const int y = layout.uniform(0, std::max(1, size.height - h));
+        const double tone = layout.uniform(30.0, 220.0);
+        cv::rectangle(img, cv::Rect(x, y, w, h), cv::Scalar(40.0 + tone * 0.2), cv::FILLED);
+    }
+
+    const cv::Point2f target = targetAt(size, t, seed);
+    const int r = std::max(2, std::min(size.width, size.height) / 12);
+    cv::circle(img, cv::Point(cvRound(target.x), cvRound(target.y)), r, cv::Scalar(235), cv::FILLED);
+    cv::GaussianBlur(img, img, cv::Size(0, 0), std::max(1.0, r / 4.0));
+
+    addNoise(img, 3.0, t, seed);
+    cv::Mat result;
+    img.convertTo(result, CV_8U);
+    return result;
+}
+
+SyntheticSource::SyntheticSource(cv::Size size, bool infrared, unsigned seed)
+    : size(size), infrared(infrared), seed(seed)
+{
+}
+
+cv::Mat SyntheticSource::frameAt(double t)
+{
+    return infrared ? SyntheticScene::renderIR(size, t, seed)
+                    : SyntheticScene::renderTV(size, t, seed);
+}